@@ -1,14 +1,19 @@
 #!/bin/bash
 set -e
 
-CMAKE_ARGS="-DBUILD_TEST=1"
+BUILD_DIR=.build-x86
+CMAKE_ARGS=(-DBUILD_TEST=1 -DCMAKE_TOOLCHAIN_FILE=cmake/gcc.cmake)
 
 if [ "$1" = "example" ]; then
-  CMAKE_ARGS="-DBUILD_EXAMPLE=1"
+  CMAKE_ARGS=(-DBUILD_EXAMPLE=1 -DCMAKE_TOOLCHAIN_FILE=cmake/gcc.cmake)
+elif [ "$1" = "benchmark" ]; then
+  # The gcc toolchain builds with coverage and without optimizations, so the benchmark uses its own configuration
+  BUILD_DIR=.build-x86-benchmark
+  CMAKE_ARGS=(-DBUILD_BENCHMARK=1 -DCMAKE_BUILD_TYPE=Release -DCMAKE_CXX_FLAGS="-Wall -Wextra -Werror -std=c++17")
 fi
 
-mkdir -p .build-x86; pushd .build-x86
-cmake "$CMAKE_ARGS" -DCMAKE_TOOLCHAIN_FILE=cmake/gcc.cmake ..
+mkdir -p "$BUILD_DIR"; pushd "$BUILD_DIR"
+cmake "${CMAKE_ARGS[@]}" ..
 make -j "$(nproc)"
 
 if [ "$1" = "coverage" ]; then
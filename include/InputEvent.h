@@ -4,184 +4,4522 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <alloca.h>
+#include <dirent.h>
 #include <fcntl.h>
 #include <linux/input.h>
+#include <linux/io_uring.h>
+#include <linux/uinput.h>
 #include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <unistd.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INPUT_EVENT_AVX2 1
+#endif
+
 namespace Linux::Input {
 
 using InputEventList = std::vector<uint16_t>;
 using InputEventCallback = std::function<void(input_event& event)>;
 using InputEventDescriptors = std::vector<int>;
 
-/// Small header-only library for handling Linux input events
-///
-/// Example:
-///
-/// #include <InputEvent.h>
-///
-/// Linux::Input::InputEvent inputEvent;
-/// int errorCode = inputEvent.subscribe({ EV_KEY }, { KEY_SPACE },
-/// [](input_event& event){
-///     if (event.code == KEY_SPACE)
-///         std::cout << "Space button " << (event.value ? "pressed" :
-///         "released") << std::endl;
-///     else if (event.code == UINT16_MAX)
-///         std::cerr << "Failed to read input events with error " <<
-///         event.value << std::endl;
-/// });
-/// if (errorCode)
-///     std::cerr << "Failed to subscribe for input events with error " <<
-///     errorCode << std::endl;
+/// @brief A non-owning view of contiguous input events
+struct InputEventSpan {
+    const input_event* data;
+    size_t size;
 
-class InputEvent {
-public:
-    /// @brief InputEvent constructor
-    /// @param inputEventPrefix The input event prefix to use (default /dev/input/event)
-    /// @param maxInputEvents The number of /dev/input/eventX files to monitor (default 10)
-    InputEvent(const std::string& inputEventPrefix = "/dev/input/event", const uint8_t maxInputEvents = 10)
+    const input_event* begin() const
     {
-        for (uint8_t inputEvent = 0; inputEvent < maxInputEvents; ++inputEvent) {
-            auto device = inputEventPrefix + std::to_string(inputEvent);
-            int result = open(device.c_str(), O_RDONLY);
-            if (result > 0)
-                m_inputDescriptors.push_back(result);
-        }
+        return data;
     }
 
-    /// @brief InputEvent destructor
-    ~InputEvent()
+    const input_event* end() const
     {
-        m_stopThread.store(true);
+        return data + size;
+    }
 
-        if (m_thread.joinable())
-            m_thread.join();
+    const input_event& operator[](size_t index) const
+    {
+        return data[index];
     }
+};
 
-    /// @brief Subscribe for input events matching the specified types and codes
-    /// In case of errors an input_event with type UINT16_MAX and code UINT16_MAX will be injected with value set to
-    /// the errno value. At the same time the thread is stopped and a new subscribe function call is required.
-    /// @note It is only possible to call subscribe once per instance
+using InputEventFrameCallback = std::function<void(InputEventSpan frame)>;
+
+/// @brief A view of a batch of input events as read from an input device with the input events matching a subscription
+struct InputEventBatch {
+    /// All input events of the batch in the read buffer (including the input events not matching the subscription)
+    InputEventSpan events;
+    /// The indices in events of the input events matching the subscription in ascending order
+    const uint32_t* indices;
+    /// The number of indices
+    size_t size;
+
+    /// @brief Get a matching input event
+    /// @param index The index of the matching input event (less than size)
+    /// @return A reference to the input event in the read buffer
+    const input_event& operator[](size_t index) const
+    {
+        return events[indices[index]];
+    }
+};
+
+using InputEventBatchCallback = std::function<void(const InputEventBatch& batch)>;
+
+/// A bitmap with the state of all event codes of an event type (large enough for any of EV_KEY, EV_SW, EV_LED and EV_SND)
+using InputEventBits = std::bitset<KEY_CNT>;
+
+/// The number of input events read per read() call when batched reads are enabled
+constexpr size_t InputEventBatchSize = 64;
+
+/// The maximum number of input events of a frame (including its SYN_REPORT event) assembled for frame subscriptions.
+/// Larger frames (e.g. of a device never sending SYN_REPORT events) are dropped (see InputEventStats::oversizedFrames).
+constexpr size_t InputEventMaxFrameSize = 16 * InputEventBatchSize;
+
+/// @brief Get the timestamp of an input event as a std::chrono time point
+/// The clock must match the clock the input devices use for timestamps (see InputEventOptions::clockId), i.e.
+/// std::chrono::system_clock for CLOCK_REALTIME (default) and std::chrono::steady_clock for CLOCK_MONOTONIC. The
+/// latency of an input event is then simply Clock::now() - inputEventTime<Clock>(event).
+/// @param event The input event to get the timestamp of
+/// @return A time point of the clock with the timestamp of the input event
+template <typename Clock = std::chrono::system_clock>
+typename Clock::time_point inputEventTime(const input_event& event)
+{
+    return typename Clock::time_point(std::chrono::duration_cast<typename Clock::duration>(std::chrono::seconds(event.input_event_sec) + std::chrono::microseconds(event.input_event_usec)));
+}
+
+/// The event type of the input events emitted for recognized gestures (see InputEventOptions::gestures). The event code
+/// is the index of the gesture in InputEventOptions::gestures and the value is 1. It lies outside of the event types of
+/// the kernel and is only matched by filters listing it explicitly (not by UINT16_MAX for all types).
+constexpr uint16_t InputEventGestureType = EV_CNT;
+
+/// @brief Filter for matching input events against a set of event types and codes in constant time
+class InputEventFilter {
+public:
+    /// @brief InputEventFilter constructor creating a filter which does not match any input events
+    InputEventFilter() = default;
+
+    /// @brief InputEventFilter constructor
     /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
     /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
-    /// @param eventCallback A callback to be invoked when an event matching the specified event types and codes is received
-    /// @return An int with the result (0 on success or or a negative value from errno.h)
-    int subscribe(const InputEventList eventTypes, const InputEventList eventCodes, const InputEventCallback eventCallback)
+    InputEventFilter(const InputEventList& eventTypes, const InputEventList& eventCodes)
     {
-        if (!eventTypes.size() || !eventCodes.size() || !eventCallback)
-            return -EINVAL;
+        add(eventTypes, eventCodes);
+    }
 
-        if (m_inputDescriptors.empty())
-            return -EBADF;
+    /// @brief Adds all combinations of the specified event types and codes to the filter
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    void add(const InputEventList& eventTypes, const InputEventList& eventCodes)
+    {
+        std::bitset<KEY_CNT> codes;
 
-        m_stopThread.store(false);
-        auto& inputDescriptors = m_inputDescriptors;
-        m_thread = std::thread([this, eventTypes = std::move(eventTypes), eventCodes = std::move(eventCodes), eventCallback = std::move(eventCallback), inputDescriptors = std::move(inputDescriptors)]() {
-            input_event event;
-            InputEventDescriptors inputEventDescriptors;
-
-            while (!m_stopThread.load()) {
-                int result = pollForInputEvent(inputDescriptors, inputEventDescriptors);
-                if (result >= 0) {
-                    for (auto inputDescriptor : inputEventDescriptors) {
-                        if (read(inputDescriptor, &event, sizeof(event)) != sizeof(event))
-                            continue;
-
-                        for (const auto type : eventTypes) {
-                            if (type == event.type || type == UINT16_MAX) {
-                                for (const auto code : eventCodes) {
-                                    if (code == event.code || code == UINT16_MAX)
-                                        eventCallback(event);
-                                }
-                            }
-                        }
-                    }
-                    inputEventDescriptors.clear();
-                } else {
-                    event = { 0, 0, UINT16_MAX, UINT16_MAX, -errno };
-                    eventCallback(event);
-                    m_stopThread.store(true);
+        for (const auto code : eventCodes) {
+            if (code == UINT16_MAX)
+                codes.set();
+            else if (code < KEY_CNT)
+                codes.set(code);
+        }
+
+        for (const auto type : eventTypes) {
+            for (uint16_t eventType = 0; eventType < Types; ++eventType) {
+                if (type == eventType || (type == UINT16_MAX && eventType != InputEventGestureType)) {
+                    m_types.set(eventType);
+                    m_codes[eventType] |= codes;
                 }
             }
+        }
+    }
 
-            for (const auto& inputDescriptor : inputDescriptors)
-                close(inputDescriptor);
-        });
+    /// @brief Adds a single event type and code to the filter
+    /// @param eventType An event type from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCode An event code from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    void add(uint16_t eventType, uint16_t eventCode)
+    {
+        if (eventType == UINT16_MAX || eventCode == UINT16_MAX)
+            add(InputEventList { eventType }, InputEventList { eventCode });
+        else if (eventType < Types && eventCode < KEY_CNT) {
+            m_types.set(eventType);
+            m_codes[eventType].set(eventCode);
+        }
+    }
 
-        return 0;
+    /// @brief Adds all event types and codes of another filter to the filter
+    /// @param filter The filter to add
+    void merge(const InputEventFilter& filter)
+    {
+        m_types |= filter.m_types;
+        for (size_t type = 0; type < Types; ++type)
+            m_codes[type] |= filter.m_codes[type];
     }
 
-    /// @brief Get current input event value for the specified event type and code
+    /// @brief Checks if the filter has any event type and code in common with another filter
+    /// @param filter The filter to check against
+    /// @return A bool which is true if at least one event type and code is part of both filters
+    bool intersects(const InputEventFilter& filter) const
+    {
+        for (size_t type = 0; type < Types; ++type) {
+            if (m_types[type] && filter.m_types[type] && (m_codes[type] & filter.m_codes[type]).any())
+                return true;
+        }
+
+        return false;
+    }
+
+    /// @brief Checks if the specified input event matches the filter
+    /// @param event The input event to check
+    /// @return A bool which is true if the type and code of the input event matches the filter
+    bool matches(const input_event& event) const
+    {
+        // Every filter ends up in the code bitmap of its type so a single lookup is sufficient
+        return event.type < Types && event.code < KEY_CNT && m_codes[event.type][event.code];
+    }
+
+    /// @brief Selects the input events of a batch matching the filter
+    /// @param events A pointer to the input events to check
+    /// @param count The number of input events to check
+    /// @param[out] indices A pointer to at least count indices to store the indices of the matching input events
+    /// @return A size_t with the number of matching input events
+    size_t select(const input_event* events, size_t count, uint32_t* indices) const
+    {
+        size_t size = 0;
+        for (size_t index = 0; index < count; ++index) {
+            indices[size] = static_cast<uint32_t>(index);
+            size += matches(events[index]);
+        }
+
+        return size;
+    }
+
+    /// @brief Get the event codes of an event type which are part of the filter
+    /// @param eventType An event type from <linux/input-event-codes.h> (less than EV_CNT) or InputEventGestureType
+    /// @return A reference to a std::bitset with a bit set for each event code matching the filter
+    const std::bitset<KEY_CNT>& codes(uint16_t eventType) const
+    {
+        return m_codes[eventType];
+    }
+
+    /// @brief Checks if the specified event type is part of the filter
+    /// @param eventType An event type from <linux/input-event-codes.h>
+    /// @return A bool which is true if any event code of the event type matches the filter
+    bool matchesType(uint16_t eventType) const
+    {
+        return eventType < Types && m_types[eventType];
+    }
+
+private:
+    /// The number of event types of the filter (the event types of the kernel and InputEventGestureType)
+    static constexpr size_t Types = InputEventGestureType + 1;
+
+    std::bitset<Types> m_types;
+    std::array<std::bitset<KEY_CNT>, Types> m_codes {};
+};
+
+/// @brief Filter of input events with an event type and event codes fixed at compile time
+/// The match is generated at compile time as a single bitmask test when all event codes lie within 64 consecutive
+/// codes and as a chain of comparisons otherwise. It can be used in place of an InputEventFilter with the filter based
+/// overloads of InputEvent::addSubscription and converts to an InputEventFilter (or the lists of types and codes) for
+/// the runtime path.
+/// @code
+/// Linux::Input::StaticFilter<EV_KEY, KEY_PLAY, KEY_PAUSE, KEY_STOP> filter;
+/// inputEvent.addSubscription(filter, [](input_event& event) { ... });
+/// @endcode
+/// @tparam EventType An event type from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+/// @tparam EventCodes Event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+template <uint16_t EventType, uint16_t... EventCodes>
+class StaticFilter {
+    static_assert(sizeof...(EventCodes) > 0, "At least one event code is required");
+    static_assert(EventType <= InputEventGestureType || EventType == UINT16_MAX, "Invalid event type");
+    static_assert(((EventCodes < KEY_CNT || EventCodes == UINT16_MAX) && ...), "Invalid event code");
+
+public:
+    /// @brief Checks if the specified event type and code matches the filter
     /// @param eventType An event type from <linux/input-event-codes.h>
     /// @param eventCode An event code from <linux/input-event-codes.h>
-    /// @return An int with the result (event value (0 or 1) on success or or a negative value from errno.h)
-    int value(uint16_t eventType, uint16_t eventCode)
+    /// @return A bool which is true if the event type and code matches the filter
+    static constexpr bool matches(uint16_t eventType, uint16_t eventCode)
     {
-        if (m_inputDescriptors.empty())
-            return -EBADF;
+        if (EventType == UINT16_MAX ? eventType == InputEventGestureType : eventType != EventType)
+            return false;
 
-        int eventValue = 0;
-        std::vector<uint8_t> eventCodeBits((eventCode / 8) + 1);
+        if constexpr (AllCodes)
+            return eventCode < KEY_CNT;
+        else if constexpr (MaxCode - MinCode < 64)
+            return static_cast<uint16_t>(eventCode - MinCode) < 64 && ((CodeMask >> static_cast<uint16_t>(eventCode - MinCode)) & 1);
+        else
+            return ((eventCode == EventCodes) || ...);
+    }
 
-        for (auto inputDescriptor : m_inputDescriptors) {
-            int result = -ENOTSUP;
+    /// @brief Checks if the specified input event matches the filter
+    /// @param event The input event to check
+    /// @return A bool which is true if the type and code of the input event matches the filter
+    constexpr bool matches(const input_event& event) const
+    {
+        return matches(event.type, event.code);
+    }
 
-            switch (eventType) {
-            case EV_KEY:
-                result = ioctl(inputDescriptor, EVIOCGKEY(eventCodeBits.size()), eventCodeBits.data());
-                break;
-            case EV_SW:
-                result = ioctl(inputDescriptor, EVIOCGSW(eventCodeBits.size()), eventCodeBits.data());
-                break;
-            default:
-                return result;
+    /// @brief Selects the input events of a batch matching the filter
+    /// @param events A pointer to the input events to check
+    /// @param count The number of input events to check
+    /// @param[out] indices A pointer to at least count indices to store the indices of the matching input events
+    /// @return A size_t with the number of matching input events
+    size_t select(const input_event* events, size_t count, uint32_t* indices) const
+    {
+        size_t size = 0;
+        for (size_t index = 0; index < count; ++index) {
+            indices[size] = static_cast<uint32_t>(index);
+            size += matches(events[index]);
+        }
+
+        return size;
+    }
+
+    /// @brief Get the event types of the filter
+    /// @return An InputEventList with the event type of the filter
+    static InputEventList types()
+    {
+        return { EventType };
+    }
+
+    /// @brief Get the event codes of the filter
+    /// @return An InputEventList with the event codes of the filter
+    static InputEventList codes()
+    {
+        return { EventCodes... };
+    }
+
+    /// @brief Converts the filter to an InputEventFilter matching the same input events
+    operator InputEventFilter() const
+    {
+        return InputEventFilter(types(), codes());
+    }
+
+private:
+    static constexpr bool AllCodes = ((EventCodes == UINT16_MAX) || ...);
+    static constexpr uint16_t MinCode = std::min({ EventCodes... });
+    static constexpr uint16_t MaxCode = std::max({ EventCodes... });
+    static constexpr uint64_t CodeMask = ((uint64_t { 1 } << ((EventCodes - MinCode) & 63)) | ...);
+};
+
+/// @brief The implementations of the batch selection of InputEventFilterKernel
+enum class InputEventFilterImplementation {
+    /// A bitmap lookup per input event (see InputEventFilter::select)
+    Scalar,
+    /// Eight input events per iteration using AVX2, gathering the types and codes with a single instruction
+    Avx2
+};
+
+/// @brief An InputEventFilter compiled for selecting the matching input events of whole batches with SIMD instructions
+/// The filter is compiled into ranges of consecutive event codes of an event type (e.g. a range of keys or a type with
+/// all of its codes), which are compared against the type and code of eight input events at a time. Filters with more
+/// than MaxRanges ranges and CPUs without AVX2 use the scalar bitmap lookup. The implementation is selected at runtime
+/// from the features of the CPU and InputEvent uses it for the subscriptions with runtime filters. See
+/// src/benchmark/Benchmark.cpp (--filter) for the timing of both implementations.
+class InputEventFilterKernel {
+public:
+    /// The maximum number of code ranges compared with SIMD instructions, as each range adds two comparisons per input
+    /// event and the scalar lookup is as fast from about six ranges
+    static constexpr size_t MaxRanges = 4;
+
+    /// @brief InputEventFilterKernel constructor
+    /// @param filter The InputEventFilter to compile
+    /// @param implementation The InputEventFilterImplementation to use (default the best supported by the CPU)
+    InputEventFilterKernel(const InputEventFilter& filter = InputEventFilter(), InputEventFilterImplementation implementation = bestImplementation())
+        : m_filter(filter)
+    {
+        for (uint16_t type = 0; type <= InputEventGestureType && m_ranges <= MaxRanges; ++type) {
+            if (!filter.matchesType(type))
+                continue;
+
+            const auto& codes = filter.codes(type);
+            for (size_t code = 0; code < codes.size() && m_ranges <= MaxRanges;) {
+                if (!codes[code]) {
+                    ++code;
+                    continue;
+                }
+
+                size_t first = code;
+                while (code < codes.size() && codes[code])
+                    ++code;
+                addRange(type, first, code - first);
             }
+        }
 
-            if (result < 0)
-                return -errno;
+        m_implementation = m_ranges <= MaxRanges && supported(implementation) ? implementation : InputEventFilterImplementation::Scalar;
+    }
 
-            eventValue |= (eventCodeBits[eventCode / 8] >> (eventCode % 8)) & 1;
+    /// @brief Checks if an implementation is supported by the CPU
+    /// @param implementation The InputEventFilterImplementation to check
+    /// @return A bool which is true if the implementation can be used
+    static bool supported(InputEventFilterImplementation implementation)
+    {
+        switch (implementation) {
+        case InputEventFilterImplementation::Scalar:
+            return true;
+#ifdef INPUT_EVENT_AVX2
+        case InputEventFilterImplementation::Avx2:
+            // The CPU features may not have been detected yet when called from a static initializer
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+        default:
+            return false;
         }
+    }
 
-        return eventValue;
+    /// @brief Get the fastest implementation supported by the CPU
+    /// @return An InputEventFilterImplementation with the implementation to use
+    static InputEventFilterImplementation bestImplementation()
+    {
+        static const InputEventFilterImplementation implementation = supported(InputEventFilterImplementation::Avx2) ? InputEventFilterImplementation::Avx2 : InputEventFilterImplementation::Scalar;
+        return implementation;
+    }
+
+    /// @brief Get the implementation used by the kernel
+    /// @return An InputEventFilterImplementation with the implementation (Scalar for filters with too many ranges)
+    InputEventFilterImplementation implementation() const
+    {
+        return m_implementation;
+    }
+
+    /// @brief Checks if the specified input event matches the filter
+    /// @param event The input event to check
+    /// @return A bool which is true if the type and code of the input event matches the filter
+    bool matches(const input_event& event) const
+    {
+        return m_filter.matches(event);
+    }
+
+    /// @brief Selects the input events of a batch matching the filter
+    /// @param events A pointer to the input events to check
+    /// @param count The number of input events to check
+    /// @param[out] indices A pointer to at least count indices to store the indices of the matching input events
+    /// @return A size_t with the number of matching input events
+    size_t select(const input_event* events, size_t count, uint32_t* indices) const
+    {
+#ifdef INPUT_EVENT_AVX2
+        if (m_implementation == InputEventFilterImplementation::Avx2)
+            return selectAvx2(events, count, indices);
+#endif
+        return m_filter.select(events, count, indices);
+    }
+
+    /// @brief Get the compiled InputEventFilter
+    operator const InputEventFilter&() const
+    {
+        return m_filter;
     }
 
 private:
-    /// @brief Polls for input events on the specified input descriptors
-    /// @param[in] inputDescriptors A reference to an InputEventDescriptors object with input descriptors
-    /// @param[out] inputEventDescriptors A reference to an InputEventDescriptors object to store input descriptors with events
-    /// @return An int with the result of the poll (see poll.h)
-    int pollForInputEvent(const InputEventDescriptors& inputDescriptors, InputEventDescriptors& InputEventDescriptors)
+    /// @brief Adds a range of event codes compared against the type and code of the input events
+    /// @param type The event type of the range
+    /// @param code The first event code of the range
+    /// @param size The number of event codes of the range
+    void addRange(uint16_t type, size_t code, size_t size)
     {
-        std::vector<pollfd> pollDescriptors;
+        // The type and code are compared as a single word with the type in the upper 16 bits. The size is biased as
+        // AVX2 only has signed comparisons.
+        if (m_ranges < MaxRanges) {
+            m_first[m_ranges] = static_cast<int32_t>(static_cast<uint32_t>(type) << 16 | code);
+            m_sizes[m_ranges] = static_cast<int32_t>(size ^ 0x80000000u);
+        }
+        ++m_ranges;
+    }
 
-        for (auto& inputDescriptor : inputDescriptors) {
-            pollfd pollDescriptor { inputDescriptor, POLLIN, 0 };
-            pollDescriptors.push_back(pollDescriptor);
+#ifdef INPUT_EVENT_AVX2
+    /// The indices of the set bits of each 8-bit match mask, one byte per index
+    static constexpr std::array<uint64_t, 256> Compaction = [] {
+        std::array<uint64_t, 256> table {};
+        for (size_t mask = 0; mask < table.size(); ++mask) {
+            for (size_t bit = 0, size = 0; bit < 8; ++bit) {
+                if ((mask >> bit) & 1)
+                    table[mask] |= static_cast<uint64_t>(bit) << (8 * size++);
+            }
         }
+        return table;
+    }();
 
-        int result = poll(pollDescriptors.data(), pollDescriptors.size(), 1000);
-        if (result > 0) {
-            for (size_t index = 0; index < pollDescriptors.size(); ++index) {
-                if (pollDescriptors.at(index).revents)
-                    InputEventDescriptors.push_back(pollDescriptors.at(index).fd);
+    __attribute__((target("avx2,popcnt"))) size_t selectAvx2(const input_event* events, size_t count, uint32_t* indices) const
+    {
+        constexpr int Stride = sizeof(input_event);
+        static_assert(offsetof(input_event, code) == offsetof(input_event, type) + sizeof(uint16_t), "The code must follow the type");
+        const __m256i offsets = _mm256_add_epi32(_mm256_setr_epi32(0, Stride, 2 * Stride, 3 * Stride, 4 * Stride, 5 * Stride, 6 * Stride, 7 * Stride), _mm256_set1_epi32(offsetof(input_event, type)));
+        const __m256i bias = _mm256_set1_epi32(INT32_MIN);
+        size_t size = 0;
+        size_t index = 0;
+
+        for (; index + 8 <= count; index += 8) {
+            // The gathered words hold the code in the upper 16 bits and are rotated to order them by type first
+            __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(events + index), offsets, 1);
+            words = _mm256_or_si256(_mm256_slli_epi32(words, 16), _mm256_srli_epi32(words, 16));
+
+            // A word lies within a range if its unsigned offset to the first word of the range is less than the size
+            __m256i match = _mm256_setzero_si256();
+            for (size_t range = 0; range < m_ranges; ++range) {
+                __m256i offset = _mm256_xor_si256(_mm256_sub_epi32(words, _mm256_set1_epi32(m_first[range])), bias);
+                match = _mm256_or_si256(match, _mm256_cmpgt_epi32(_mm256_set1_epi32(m_sizes[range]), offset));
             }
+
+            // The indices of the matching input events are compacted with a table lookup instead of a loop over the bits
+            unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(match));
+            __m256i selected = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&Compaction[mask]))), _mm256_set1_epi32(static_cast<int>(index)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + size), selected);
+            size += _mm_popcnt_u32(mask);
         }
 
-        return result;
+        for (; index < count; ++index) {
+            indices[size] = static_cast<uint32_t>(index);
+            size += m_filter.matches(events[index]);
+        }
+
+        return size;
     }
+#endif
 
-    std::thread m_thread;
-    std::atomic<bool> m_stopThread;
-    InputEventDescriptors m_inputDescriptors;
+    InputEventFilter m_filter;
+    std::array<int32_t, MaxRanges> m_first {};
+    std::array<int32_t, MaxRanges> m_sizes {};
+    size_t m_ranges = 0;
+    InputEventFilterImplementation m_implementation = InputEventFilterImplementation::Scalar;
+};
+
+/// @brief Bounded lock-free single-producer/single-consumer queue of input events
+/// The producer is the worker thread of an InputEvent instance (see InputEvent::addSubscription) and the consumer is a
+/// single application thread draining the queue. The descriptor becomes readable when new events have been queued. A
+/// consumer must call clearNotification before popping events to not miss a notification (or simply use drain).
+class InputEventQueue {
+public:
+    /// @brief InputEventQueue constructor
+    /// @param capacity The maximum number of queued input events (rounded up to a power of two, default 1024)
+    explicit InputEventQueue(size_t capacity = 1024)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        m_events.resize(size);
+        m_mask = size - 1;
+        m_descriptor = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    }
+
+    /// @brief InputEventQueue destructor
+    ~InputEventQueue()
+    {
+        if (m_descriptor >= 0)
+            close(m_descriptor);
+    }
+
+    InputEventQueue(const InputEventQueue&) = delete;
+    InputEventQueue& operator=(const InputEventQueue&) = delete;
+
+    /// @brief Queues an input event (producer only)
+    /// @param event The input event to queue
+    /// @return A bool which is true if the event was queued or false if the queue is full (the overflow count is increased)
+    bool push(const input_event& event)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+            m_overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_events[tail & m_mask] = event;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Notifies the consumer that input events have been queued (producer only)
+    void notify()
+    {
+        if (m_descriptor >= 0) {
+            uint64_t value = 1;
+            [[maybe_unused]] auto result = write(m_descriptor, &value, sizeof(value));
+        }
+    }
+
+    /// @brief Dequeues an input event (consumer only)
+    /// @param[out] event A reference to an input_event to store the dequeued event
+    /// @return A bool which is true if an event was dequeued or false if the queue is empty
+    bool pop(input_event& event)
+    {
+        return pop(&event, 1) == 1;
+    }
+
+    /// @brief Dequeues up to the specified number of input events (consumer only)
+    /// @param[out] events A pointer to an array to store the dequeued events
+    /// @param maxEvents The maximum number of events to dequeue
+    /// @return A size_t with the number of dequeued events
+    size_t pop(input_event* events, size_t maxEvents)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t count = std::min(m_tail.load(std::memory_order_acquire) - head, maxEvents);
+
+        for (size_t index = 0; index < count; ++index)
+            events[index] = m_events[(head + index) & m_mask];
+
+        m_head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /// @brief Clears a pending notification of the descriptor (consumer only)
+    void clearNotification()
+    {
+        uint64_t value;
+        [[maybe_unused]] auto result = read(m_descriptor, &value, sizeof(value));
+    }
+
+    /// @brief Clears a pending notification and dequeues all input events (consumer only)
+    /// @param eventCallback A callable invoked with a reference to each dequeued input_event
+    /// @return A size_t with the number of dequeued events
+    template <typename Callback>
+    size_t drain(Callback&& eventCallback)
+    {
+        size_t count = 0;
+        input_event event;
+
+        clearNotification();
+        while (pop(event)) {
+            eventCallback(event);
+            ++count;
+        }
+
+        return count;
+    }
+
+    /// @brief Get the descriptor which becomes readable when input events have been queued
+    /// @return An int with the descriptor (or a negative value if it could not be created)
+    int descriptor() const
+    {
+        return m_descriptor;
+    }
+
+    /// @brief Get the number of input events dropped as the queue was full
+    /// @return A uint64_t with the number of dropped events
+    uint64_t overflows() const
+    {
+        return m_overflows.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Get the maximum number of queued input events
+    /// @return A size_t with the capacity of the queue
+    size_t capacity() const
+    {
+        return m_mask + 1;
+    }
+
+private:
+    // The indices are only increasing and kept on separate cache lines to avoid false sharing between the threads
+    alignas(64) std::atomic<size_t> m_head { 0 };
+    alignas(64) std::atomic<size_t> m_tail { 0 };
+    alignas(64) std::atomic<uint64_t> m_overflows { 0 };
+    std::vector<input_event> m_events;
+    size_t m_mask;
+    int m_descriptor;
+};
+
+/// @brief Identification and capabilities of an input device, read once when the input device is opened
+struct InputEventDeviceInfo {
+    /// A number identifying the input device within an InputEvent instance (not reused when a device is reopened)
+    int index = -1;
+    /// The path of the input device (e.g. /dev/input/event0)
+    std::string path;
+    /// The name of the input device (see EVIOCGNAME)
+    std::string name;
+    /// The physical location of the input device (see EVIOCGPHYS)
+    std::string phys;
+    /// The bus type, vendor, product and version of the input device (see EVIOCGID)
+    input_id id {};
+    /// The event types and codes supported by the input device (all if they can not be read, see EVIOCGBIT)
+    InputEventFilter capabilities;
+};
+
+/// A callback receiving an input event and the input device it was read from
+using InputEventDeviceCallback = std::function<void(input_event& event, const InputEventDeviceInfo& device)>;
+
+/// Checks if a callable can be used for input event subscriptions (with or without the input device)
+template <typename Callback>
+constexpr bool IsInputEventCallback = std::is_invocable_v<Callback&, input_event&> || std::is_invocable_v<Callback&, input_event&, const InputEventDeviceInfo&>;
+
+/// Checks if a callable can be used for frame subscriptions (with or without the input device)
+template <typename Callback>
+constexpr bool IsInputEventFrameCallback = std::is_invocable_v<Callback&, InputEventSpan> || std::is_invocable_v<Callback&, InputEventSpan, const InputEventDeviceInfo&>;
+
+/// Checks if a callable can be used for batch subscriptions (with or without the input device)
+template <typename Callback>
+constexpr bool IsInputEventBatchCallback = std::is_invocable_v<Callback&, const InputEventBatch&> || std::is_invocable_v<Callback&, const InputEventBatch&, const InputEventDeviceInfo&>;
+
+/// @brief Recorder of input event streams to a compact append-only file
+/// The file starts with a header followed by variable length records. A device record (written once per input device
+/// before its first input event) holds the name and id of the input device and an event record holds the index of
+/// the input device, the timestamp as a delta in microseconds to the previous event record, the type, the code and the
+/// value, all encoded as (zigzag) varints. Most input events take 6 to 8 bytes instead of sizeof(input_event). The
+/// file is memory mapped and grown as needed so recording does not issue a system call per input event. It is
+/// truncated to the recorded size when the recorder is destroyed. No record starts with a zero byte, so the unused
+/// zero filled end of the file of a recording process which did not exit cleanly ends the recording when replayed.
+/// See InputEvent::setRecorder and InputEventReplayer.
+class InputEventRecorder {
+public:
+    /// The magic number (and version) at the start of a recording
+    static constexpr uint32_t Magic = 0x32564549; // "IEV2"
+
+    /// @brief InputEventRecorder constructor creating (or truncating) the file to record to
+    /// @param path The path of the file
+    /// @param capacity The initial size of the mapping in bytes (default 1 MiB), doubled when it is full
+    explicit InputEventRecorder(const std::string& path, size_t capacity = 1024 * 1024)
+    {
+        m_descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_descriptor < 0)
+            return;
+
+        if (!reserve(std::max<size_t>(capacity, MaxRecordSize))) {
+            close(m_descriptor);
+            m_descriptor = -1;
+            return;
+        }
+
+        std::memcpy(m_data, &Magic, sizeof(Magic));
+        m_size = sizeof(Magic);
+    }
+
+    /// @brief InputEventRecorder destructor truncating the file to the recorded size
+    ~InputEventRecorder()
+    {
+        if (m_data)
+            munmap(m_data, m_capacity);
+
+        if (m_descriptor >= 0) {
+            [[maybe_unused]] auto result = ftruncate(m_descriptor, m_size);
+            close(m_descriptor);
+        }
+    }
+
+    InputEventRecorder(const InputEventRecorder&) = delete;
+    InputEventRecorder& operator=(const InputEventRecorder&) = delete;
+
+    /// @brief Get the descriptor of the file recorded to
+    /// @return An int with the descriptor (or a negative value if the file could not be created)
+    int descriptor() const
+    {
+        return m_descriptor;
+    }
+
+    /// @brief Get the number of bytes recorded
+    /// @return A size_t with the size of the recording
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    /// @brief Record a new input device
+    /// @param info The identification of the input device
+    /// @return An int with the result (the index of the input device on success or a negative value from errno.h)
+    int addDevice(const InputEventDeviceInfo& info)
+    {
+        if (m_descriptor < 0)
+            return -EBADF;
+
+        if (!reserve(m_size + MaxRecordSize))
+            return -ENOMEM;
+
+        size_t nameSize = std::min<size_t>(info.name.size(), MaxNameSize);
+        putVarint(static_cast<uint64_t>(m_devices) << 1 | 1);
+        putVarint(info.id.bustype);
+        putVarint(info.id.vendor);
+        putVarint(info.id.product);
+        putVarint(info.id.version);
+        putVarint(nameSize);
+        std::memcpy(m_data + m_size, info.name.data(), nameSize);
+        m_size += nameSize;
+
+        return m_devices++;
+    }
+
+    /// @brief Record input events of an input device
+    /// @param device The index of the input device returned by addDevice
+    /// @param events A pointer to the input events to record
+    /// @param count The number of input events to record
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int record(int device, const input_event* events, size_t count)
+    {
+        if (m_descriptor < 0)
+            return -EBADF;
+
+        if (device < 0 || device >= m_devices)
+            return -EINVAL;
+
+        for (size_t index = 0; index < count; ++index) {
+            if (m_size + MaxRecordSize > m_capacity && !reserve(m_size + MaxRecordSize))
+                return -ENOMEM;
+
+            const auto& event = events[index];
+            int64_t time = static_cast<int64_t>(event.input_event_sec) * 1000000 + event.input_event_usec;
+            // The index is biased so the header of an event record is never zero
+            putVarint(static_cast<uint64_t>(device + 1) << 1);
+            putVarint(zigzag(time - m_time));
+            putVarint(event.type);
+            putVarint(event.code);
+            putVarint(zigzag(event.value));
+            m_time = time;
+        }
+
+        return 0;
+    }
+
+    /// @brief Encodes a signed value so small magnitudes result in short varints
+    /// @param value The value to encode
+    /// @return A uint64_t with the encoded value
+    static uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+private:
+    /// The maximum length of a device name in a device record
+    static constexpr size_t MaxNameSize = 256;
+    /// The maximum size of a single record in bytes
+    static constexpr size_t MaxRecordSize = 6 * 10 + MaxNameSize;
+
+    /// @brief Makes sure the mapping of the file is at least the specified size
+    /// @param size The number of bytes needed
+    /// @return A bool which is true if the mapping is large enough
+    bool reserve(size_t size)
+    {
+        if (size <= m_capacity)
+            return true;
+
+        size_t capacity = std::max(size, m_capacity * 2);
+        if (ftruncate(m_descriptor, capacity) < 0)
+            return false;
+
+        void* data = m_data ? mremap(m_data, m_capacity, capacity, MREMAP_MAYMOVE) : mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_descriptor, 0);
+        if (data == MAP_FAILED)
+            return false;
+
+        m_data = static_cast<uint8_t*>(data);
+        m_capacity = capacity;
+        return true;
+    }
+
+    /// @brief Appends a varint to the recording (the space must have been reserved)
+    void putVarint(uint64_t value)
+    {
+        for (; value >= 0x80; value >>= 7)
+            m_data[m_size++] = static_cast<uint8_t>(value | 0x80);
+        m_data[m_size++] = static_cast<uint8_t>(value);
+    }
+
+    int m_descriptor = -1;
+    uint8_t* m_data = nullptr;
+    size_t m_capacity = 0;
+    size_t m_size = 0;
+    int m_devices = 0;
+    int64_t m_time = 0;
+};
+
+/// @brief Reader of input event streams recorded with InputEventRecorder (see InputEvent::replay)
+class InputEventReplayer {
+public:
+    /// @brief InputEventReplayer constructor mapping a recording
+    /// @param path The path of the recording
+    explicit InputEventReplayer(const std::string& path)
+    {
+        m_descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_descriptor < 0)
+            return;
+
+        struct stat status {};
+        uint32_t magic = 0;
+        if (fstat(m_descriptor, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(magic)) {
+            void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, m_descriptor, 0);
+            if (data != MAP_FAILED) {
+                m_data = static_cast<const uint8_t*>(data);
+                m_size = status.st_size;
+                std::memcpy(&magic, m_data, sizeof(magic));
+            }
+        }
+
+        if (magic != InputEventRecorder::Magic) {
+            close(m_descriptor);
+            m_descriptor = -1;
+        }
+
+        rewind();
+    }
+
+    /// @brief InputEventReplayer destructor
+    ~InputEventReplayer()
+    {
+        if (m_data)
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+
+        if (m_descriptor >= 0)
+            close(m_descriptor);
+    }
+
+    InputEventReplayer(const InputEventReplayer&) = delete;
+    InputEventReplayer& operator=(const InputEventReplayer&) = delete;
+
+    /// @brief Get the descriptor of the recording
+    /// @return An int with the descriptor (or a negative value if the recording could not be opened or is invalid)
+    int descriptor() const
+    {
+        return m_descriptor;
+    }
+
+    /// @brief Get the input devices of the recording read so far
+    /// @return A reference to a std::vector with the identification of each input device by index
+    const std::vector<InputEventDeviceInfo>& devices() const
+    {
+        return m_devices;
+    }
+
+    /// @brief Read the next input event of the recording
+    /// @param[out] device The index of the input device of the input event
+    /// @param[out] event The input event
+    /// @return A bool which is true if an input event was read (or false at the end of the recording)
+    bool next(size_t& device, input_event& event)
+    {
+        uint64_t header;
+        while (m_descriptor >= 0 && getVarint(header) && header) {
+            if (header & 1) {
+                InputEventDeviceInfo info;
+                uint64_t bustype, vendor, product, version, nameSize;
+                if (!getVarint(bustype) || !getVarint(vendor) || !getVarint(product) || !getVarint(version) || !getVarint(nameSize) || nameSize > m_size - m_offset)
+                    break;
+
+                info.id = { static_cast<uint16_t>(bustype), static_cast<uint16_t>(vendor), static_cast<uint16_t>(product), static_cast<uint16_t>(version) };
+                info.name.assign(reinterpret_cast<const char*>(m_data + m_offset), nameSize);
+                m_offset += nameSize;
+                m_devices.push_back(std::move(info));
+                continue;
+            }
+
+            uint64_t delta, type, code, value;
+            if (!getVarint(delta) || !getVarint(type) || !getVarint(code) || !getVarint(value) || (header >> 1) > m_devices.size())
+                break;
+
+            m_time += unzigzag(delta);
+            device = (header >> 1) - 1;
+            event = {};
+            event.input_event_sec = m_time / 1000000;
+            event.input_event_usec = m_time % 1000000;
+            event.type = type;
+            event.code = code;
+            event.value = unzigzag(value);
+            return true;
+        }
+
+        // A truncated record (or the zero filled end of an unfinished recording) ends the recording
+        m_offset = m_size;
+        return false;
+    }
+
+    /// @brief Restarts reading at the first input event of the recording
+    void rewind()
+    {
+        m_offset = sizeof(InputEventRecorder::Magic);
+        m_time = 0;
+        m_devices.clear();
+    }
+
+private:
+    /// @brief Decodes a value encoded with InputEventRecorder::zigzag
+    /// @param value The value to decode
+    /// @return An int64_t with the decoded value
+    static int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    /// @brief Reads a varint from the recording
+    /// @param[out] value The value read
+    /// @return A bool which is true if a complete varint was read
+    bool getVarint(uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; m_offset < m_size && shift < 64; shift += 7) {
+            uint8_t byte = m_data[m_offset++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+
+        return false;
+    }
+
+    int m_descriptor = -1;
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_offset = 0;
+    int64_t m_time = 0;
+    std::vector<InputEventDeviceInfo> m_devices;
+};
+
+/// @brief The mechanism used for waiting for input events
+enum class InputEventBackend {
+    /// Use poll() on the input descriptors
+    Poll,
+    /// Use a persistent epoll instance with the input descriptors registered once at construction
+    Epoll,
+    /// Use an io_uring instance with a read posted for each input device, so the completed reads of all ready devices
+    /// are handled and posted again with one io_uring_enter() call per wakeup when the kernel can poll the device for
+    /// the read itself (e.g. FIFOs). The evdev driver does not support this, so reads of blocking input devices are
+    /// each parked in a kernel io-wq worker thread, while reads of non-blocking input devices (see
+    /// InputEventOptions::nonBlocking) complete with EAGAIN and are retried after a poll for readiness. The latter
+    /// takes three operations (the poll, the read and the read failing with EAGAIN) and as many io_uring_enter()
+    /// calls per wakeup. Falls back to Epoll when io_uring is not available (see InputEvent::backend).
+    IoUring
+};
+
+/// @brief Debouncing and repeat limiting of the input events of a type and code (see InputEventOptions::debounce)
+struct InputEventDebounce {
+    /// The event type from <linux/input-event-codes.h> (or UINT16_MAX for all types except EV_SYN)
+    uint16_t type = UINT16_MAX;
+    /// The event code from <linux/input-event-codes.h> (or UINT16_MAX for all codes)
+    uint16_t code = UINT16_MAX;
+    /// Value changes within this time after the last delivered change are held back and only the last value is
+    /// delivered when the time has passed (if it differs from the delivered value). Input events not changing the
+    /// value are dropped. EV_KEY repeat events are not debounced.
+    std::chrono::microseconds window { 0 };
+    /// The minimum time between two delivered EV_KEY repeat events (value 2) and between a key press and its first
+    /// delivered repeat event. Repeat events arriving earlier are dropped.
+    std::chrono::microseconds repeatInterval { 0 };
+};
+
+/// @brief The kinds of gestures recognized by InputEvent (see InputEventGesture)
+enum class InputEventGestureKind {
+    /// A code pressed and held for at least the time of the gesture (recognized when the time has passed)
+    LongPress,
+    /// A code pressed twice within the time of the gesture (recognized with the second press)
+    DoublePress,
+    /// All codes held at the same time and pressed within the time of the gesture (recognized with the last press)
+    Chord
+};
+
+/// @brief A gesture recognized from the input events of each input device (see InputEventOptions::gestures)
+struct InputEventGesture {
+    /// The kind of gesture
+    InputEventGestureKind kind = InputEventGestureKind::LongPress;
+    /// The event type of the codes (normally EV_KEY)
+    uint16_t type = EV_KEY;
+    /// The event code for presses or all event codes of a chord (at most 64 codes)
+    InputEventList codes;
+    /// The hold time of a long press, the maximum time between the presses of a double press or between the first and
+    /// last press of a chord
+    std::chrono::microseconds time { 500000 };
+};
+
+/// @brief Options for configuring an InputEvent instance
+struct InputEventOptions {
+    /// The mechanism used for waiting for input events
+    InputEventBackend backend = InputEventBackend::Poll;
+
+    /// Open the input devices non-blocking and drain all pending events of a device per poll wakeup in batches of
+    /// InputEventBatchSize events (instead of reading a single event per poll wakeup)
+    bool batchedRead = false;
+    /// Open the input devices non-blocking (always the case with batchedRead), so a spurious readiness reported by the
+    /// wait mechanism can not block the worker thread in read
+    bool nonBlocking = false;
+    /// Grab the input devices when they are opened (using EVIOCGRAB), so their input events are only delivered to this
+    /// instance and not to other readers (e.g. the console or a display server). Devices which can not be grabbed
+    /// (e.g. as they are grabbed by another reader) are opened without it (see InputEvent::grabDevice).
+    bool grab = false;
+    /// Keep track of the key, switch, LED and sound state of the input devices. When the kernel drops events
+    /// (SYN_DROPPED) the events up to the next SYN_REPORT are discarded and the missed state changes are synthesized
+    /// from the current state of the input devices followed by a SYN_REPORT event
+    bool resynchronize = false;
+    /// Keep an in-memory copy of the key, switch, LED, sound and absolute axis state of the input devices, which is
+    /// seeded once at construction and maintained by the worker thread from the received events. InputEvent::value
+    /// then reads the cached state without issuing any ioctls or taking any locks. The key, switch, LED and sound
+    /// values are combined for all devices, while the absolute axis value is the one of the first opened device
+    /// supporting the axis.
+    bool cacheState = false;
+    /// Watch the directory of the input event prefix (using inotify) and open or close input devices when they are
+    /// added or removed while the other devices continue to be monitored. Subscriptions are possible without any
+    /// input devices being present.
+    bool hotPlug = false;
+    /// Open all input devices in the directory of the input event prefix (e.g. /dev/input/event*) instead of probing
+    /// the first maxInputEvents devices
+    bool scanDirectory = false;
+    /// Read the supported event types and codes of each input device (using EVIOCGBIT) and only monitor the devices
+    /// which can produce events matching a subscription. Devices with unknown capabilities are always monitored and all
+    /// devices are monitored with cacheState enabled. The devices which are not monitored stay open with their input
+    /// events masked in the kernel (using EVIOCSMASK where supported). Anything queued meanwhile is discarded once a new
+    /// subscription matching such a device has been applied by the worker thread.
+    bool filterDevices = false;
+    /// Push the combined filter of the subscriptions into the kernel for each input device (using EVIOCSMASK where
+    /// supported), so events which do not match any subscription are not read at all. EV_SYN events are always
+    /// received and no events are masked when resynchronize or cacheState is enabled as they depend on all events.
+    /// The masked events are not seen by InputEvent::setRecorder either, so a recording only contains the events
+    /// matching the subscriptions at the time they were read.
+    bool kernelFilter = false;
+    /// Do not create a worker thread. Instead the application waits for InputEvent::descriptor to become readable
+    /// (e.g. in its own event loop) and calls InputEvent::dispatch, which reads the pending input events and invokes the
+    /// callbacks on the calling thread. The epoll backend is always used in this mode and the thread options are ignored.
+    bool externalDispatch = false;
+    /// Maintain the counters and the latency histogram returned by InputEvent::stats. When disabled the statistics
+    /// cost a single branch per batch.
+    bool collectStats = false;
+    /// The clock used by the input devices for the timestamps of the input events (CLOCK_REALTIME, CLOCK_MONOTONIC or
+    /// CLOCK_BOOTTIME, set with EVIOCSCLOCKID when the input devices are opened). A monotonic clock is not affected by
+    /// changes of the system time (see inputEventTime).
+    clockid_t clockId = CLOCK_REALTIME;
+    /// The number of threads reading and dispatching the input events, with the input devices distributed evenly
+    /// across the threads when they are opened. Each additional thread has its own epoll instance (so the epoll backend
+    /// is always used with more than one thread, except with externalDispatch where it is ignored) and the thread
+    /// options apply to all of the threads. The threads read, debounce and assemble the input events of their devices
+    /// in parallel, while the callbacks are invoked one at a time unless concurrentCallbacks is enabled.
+    size_t readerThreads = 1;
+    /// Allow the callbacks of different subscriptions to be invoked concurrently from several reader threads. The
+    /// invocations of each subscription are still serialized, i.e. a callback is never invoked concurrently with
+    /// itself. When disabled no two callbacks are ever invoked concurrently. Removing a subscription waits for its
+    /// callback running on another reader thread, so two callbacks must not remove each other's subscriptions.
+    bool concurrentCallbacks = false;
+    /// Debounce and rate limit input events in the worker thread before they are dispatched to the subscriptions (and
+    /// the state cache). The first matching entry applies to an input event. The kernel timestamps of the input events
+    /// are compared and held back values are delivered from a timer using the clock of the input devices (or right
+    /// before the first input event read after their deadline), followed by a SYN_REPORT event. Frames with all of
+    /// their input events held back or dropped are dropped completely. The state cache and resynchronize therefore
+    /// follow the delivered values, so InputEvent::value with cacheState returns the debounced values and the changes
+    /// synthesized after a SYN_DROPPED event (which are not debounced) are relative to the delivered values.
+    std::vector<InputEventDebounce> debounce;
+    /// Recognize gestures from the (debounced) input events and dispatch an input event of InputEventGestureType for
+    /// each recognized gesture followed by a SYN_REPORT event, right after the input events completing it. The gestures
+    /// share the timer of the held back values. Values of 0 release and other values press a code.
+    std::vector<InputEventGesture> gestures;
+
+    /// Scheduling policy of the worker thread (SCHED_OTHER, SCHED_FIFO or SCHED_RR). The thread options are applied
+    /// when the worker thread (and the reader threads) are started by adding a subscription, which fails with the
+    /// error if they can not be applied (e.g. -EPERM without the privileges for a real-time policy).
+    int threadPolicy = SCHED_OTHER;
+    /// Scheduling priority of the worker thread (1 to 99 for SCHED_FIFO and SCHED_RR, 0 otherwise)
+    int threadPriority = 0;
+    /// CPU affinity mask of the worker thread with a bit set for each allowed CPU (0 for all CPUs)
+    uint64_t threadAffinity = 0;
+    /// Name of the worker thread (at most 15 characters, empty to keep the name of the creating thread)
+    std::string threadName;
+    /// Number of bytes of the worker thread stack to touch when it starts, so the stack is resident (and locked with
+    /// mlockall(MCL_CURRENT | MCL_FUTURE)) before the first input event is handled. It must be less than the stack
+    /// size of the thread (8 MiB by default).
+    size_t threadStackPrefault = 0;
+};
+
+/// The number of buckets of the latency histogram of InputEventStats
+constexpr size_t InputEventLatencyBuckets = 16;
+
+/// @brief Statistics of an InputEvent instance (see InputEventOptions::collectStats)
+struct InputEventStats {
+    /// The number of input events read from the input devices
+    uint64_t events = 0;
+    /// The number of batches of input events read
+    uint64_t batches = 0;
+    /// The number of input events not matching any subscription
+    uint64_t filtered = 0;
+    /// The number of input events delivered to subscriptions (counted once for each matching subscription)
+    uint64_t deliveries = 0;
+    /// The number of SYN_DROPPED events, i.e. the number of times the kernel buffer of an input device overflowed
+    uint64_t dropped = 0;
+    /// The number of input events held back or dropped by InputEventOptions::debounce (including empty frames)
+    uint64_t debounced = 0;
+    /// The number of frames dropped for frame subscriptions as they exceeded InputEventMaxFrameSize
+    uint64_t oversizedFrames = 0;
+    /// The total time spent in the callbacks and queues of the subscriptions in nanoseconds
+    uint64_t callbackTime = 0;
+    /// The longest time spent in a subscription for a single batch in nanoseconds
+    uint64_t maxCallbackTime = 0;
+    /// Histogram of the latency from the kernel timestamp of an input event to its dispatch. Bucket N counts the input
+    /// events with a latency below 2^N microseconds (and at least 2^(N-1)) and the last bucket all longer latencies.
+    std::array<uint64_t, InputEventLatencyBuckets> latency {};
+};
+
+/// Small header-only library for handling Linux input events
+///
+/// Example:
+///
+/// #include <InputEvent.h>
+///
+/// Linux::Input::InputEvent inputEvent;
+/// int errorCode = inputEvent.subscribe({ EV_KEY }, { KEY_SPACE },
+/// [](input_event& event){
+///     if (event.code == KEY_SPACE)
+///         std::cout << "Space button " << (event.value ? "pressed" :
+///         "released") << std::endl;
+///     else if (event.code == UINT16_MAX)
+///         std::cerr << "Failed to read input events with error " <<
+///         event.value << std::endl;
+/// });
+/// if (errorCode)
+///     std::cerr << "Failed to subscribe for input events with error " <<
+///     errorCode << std::endl;
+
+class InputEvent {
+public:
+    /// @brief InputEvent constructor
+    /// @param inputEventPrefix The input event prefix to use (default /dev/input/event)
+    /// @param maxInputEvents The number of /dev/input/eventX files to monitor (default 10)
+    /// @param options The InputEventOptions to use (default InputEventOptions())
+    InputEvent(const std::string& inputEventPrefix = "/dev/input/event", const uint8_t maxInputEvents = 10, const InputEventOptions& options = InputEventOptions())
+        : m_options(resolveOptions(options))
+        , m_inputEventPrefix(inputEventPrefix)
+        , m_maxInputEvents(maxInputEvents)
+        , m_openFlags(O_RDONLY | O_CLOEXEC | (options.batchedRead || options.nonBlocking ? O_NONBLOCK : 0))
+        , m_backend(m_options.backend)
+    {
+        if (m_backend == InputEventBackend::IoUring && !setupRing())
+            m_backend = InputEventBackend::Epoll;
+
+        if (m_backend == InputEventBackend::Epoll)
+            m_epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+
+        m_readyDescriptors.reserve(MaxReadyDescriptors);
+
+        // The wakeup descriptor allows the worker thread to block until input events arrive or it is stopped. If it can
+        // not be created the worker thread falls back to checking for a stop request every second
+        m_wakeupDescriptor = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_wakeupDescriptor >= 0 && registerDescriptor(m_wakeupDescriptor))
+            m_waitTimeout = -1;
+
+        for (const auto& gesture : m_options.gestures)
+            m_gestureFilter.add({ gesture.type }, gesture.codes);
+
+        // Without the timer held back values and long presses are only delivered with the next input events of the
+        // device
+        if (!m_options.debounce.empty() || !m_options.gestures.empty()) {
+            m_timer.descriptor = timerfd_create(m_options.clockId, TFD_CLOEXEC | TFD_NONBLOCK);
+            if (m_timer.descriptor >= 0 && !registerDescriptor(m_timer.descriptor)) {
+                close(m_timer.descriptor);
+                m_timer.descriptor = -1;
+            }
+        }
+
+        if (m_options.readerThreads > 1 && m_epollDescriptor >= 0)
+            setupReaders();
+
+        // The directory is watched before probing the devices to not miss devices added in between
+        if (m_options.hotPlug) {
+            auto separator = m_inputEventPrefix.rfind('/');
+            auto directory = separator == std::string::npos ? "." : m_inputEventPrefix.substr(0, separator + 1);
+
+            m_inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (m_inotifyDescriptor >= 0 && (inotify_add_watch(m_inotifyDescriptor, directory.c_str(), IN_CREATE | IN_ATTRIB | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) < 0 || !registerDescriptor(m_inotifyDescriptor))) {
+                close(m_inotifyDescriptor);
+                m_inotifyDescriptor = -1;
+            }
+        }
+
+        if (m_options.scanDirectory)
+            scanDevices();
+        else {
+            for (uint8_t inputEvent = 0; inputEvent < maxInputEvents; ++inputEvent)
+                openDevice(inputEventPrefix + std::to_string(inputEvent));
+        }
+
+        // The cached state is maintained by the worker thread so it is needed even without subscriptions. A failure to
+        // apply the thread options is returned by the next subscription, which starts the thread again.
+        if (m_options.cacheState && (!m_devices.empty() || m_inotifyDescriptor >= 0))
+            startThread();
+    }
+
+    /// @brief InputEvent destructor
+    ~InputEvent()
+    {
+        m_stopThread.store(true);
+        wakeup();
+
+        if (m_thread.joinable())
+            m_thread.join();
+
+        // The reads posted to the buffers of the ring slots are cancelled before the buffers are freed
+        if (m_ring.descriptor >= 0)
+            cancelRing();
+
+        for (const auto& device : m_devices)
+            close(device->descriptor);
+
+        if (m_inotifyDescriptor >= 0)
+            close(m_inotifyDescriptor);
+
+        if (m_wakeupDescriptor >= 0)
+            close(m_wakeupDescriptor);
+
+        if (m_timer.descriptor >= 0)
+            close(m_timer.descriptor);
+
+        if (m_epollDescriptor >= 0)
+            close(m_epollDescriptor);
+
+        closeReaders();
+
+        closeRing();
+    }
+
+    /// @brief Subscribe for input events matching the specified types and codes
+    /// In case of errors an input_event with type UINT16_MAX and code UINT16_MAX will be injected with value set to
+    /// the errno value. At the same time the thread is stopped and a new subscribe function call is required.
+    /// @note Multiple subscriptions share the same input descriptors and thread (see addSubscription)
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param eventCallback A callback to be invoked when an event matching the specified event types and codes is received
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int subscribe(const InputEventList eventTypes, const InputEventList eventCodes, const InputEventCallback eventCallback)
+    {
+        int result = addSubscription(eventTypes, eventCodes, eventCallback);
+        return result < 0 ? result : 0;
+    }
+
+    /// @brief Subscribe for input events matching the specified types and codes with a callable stored by value
+    /// Unlike the InputEventCallback overload the callable is not type-erased, so the filter and the callable are
+    /// inlined in the dispatch loop of the subscription (see addSubscription).
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param eventCallback A callable invocable with a const input_event& (or a copy as input_event&) for events matching the specified event types and codes
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    template <typename Callback, typename = std::enable_if_t<IsInputEventCallback<Callback>>>
+    int subscribe(const InputEventList& eventTypes, const InputEventList& eventCodes, Callback eventCallback)
+    {
+        int result = addSubscription(eventTypes, eventCodes, std::move(eventCallback));
+        return result < 0 ? result : 0;
+    }
+
+    /// @brief Add a subscription for input events matching the specified types and codes
+    /// All subscriptions of an instance share the input descriptors and the thread reading from them. The callbacks are
+    /// invoked from this thread in the order the subscriptions were added, for each read batch one subscription at a
+    /// time. Error events are injected to all subscriptions as described for subscribe.
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param eventCallback A callback to be invoked when an event matching the specified event types and codes is received
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    int addSubscription(const InputEventList& eventTypes, const InputEventList& eventCodes, const InputEventCallback& eventCallback)
+    {
+        if (!eventCallback)
+            return -EINVAL;
+
+        return addSubscription<InputEventCallback>(eventTypes, eventCodes, eventCallback);
+    }
+
+    /// @brief Add a subscription for input events matching the specified types and codes with a callable stored by value
+    /// The callable is invoked directly (without the indirection of std::function) and can be inlined together with
+    /// the filter of the subscription. Otherwise it behaves as the InputEventCallback overload.
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param eventCallback A callable invocable with a const input_event& (or a copy as input_event&) for events matching the specified event types and codes
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    template <typename Callback, typename = std::enable_if_t<IsInputEventCallback<Callback>>>
+    int addSubscription(const InputEventList& eventTypes, const InputEventList& eventCodes, Callback eventCallback)
+    {
+        if constexpr (std::is_pointer_v<Callback>) {
+            if (!eventCallback)
+                return -EINVAL;
+        }
+
+        if (!validSubscription(eventTypes, eventCodes))
+            return -EINVAL;
+
+        return insertSubscription(std::make_unique<CallbackSubscription<InputEventFilter, Callback>>(InputEventFilter(eventTypes, eventCodes), std::move(eventCallback)));
+    }
+
+    /// @brief Add a subscription for input events matching the specified types and codes delivered to a queue
+    /// Instead of invoking a callback on the worker thread the input events are pushed to the queue, which is notified
+    /// once per read batch. This decouples reading the input events from processing them on the application thread.
+    /// @note The queue must stay valid until the subscription is removed or the instance is destroyed
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param eventQueue The InputEventQueue to push input events matching the specified event types and codes to
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    int addSubscription(const InputEventList& eventTypes, const InputEventList& eventCodes, InputEventQueue& eventQueue)
+    {
+        if (eventQueue.descriptor() < 0)
+            return -EBADF;
+
+        if (!validSubscription(eventTypes, eventCodes))
+            return -EINVAL;
+
+        return insertSubscription(std::make_unique<QueueSubscription<InputEventFilter>>(InputEventFilter(eventTypes, eventCodes), eventQueue));
+    }
+
+    /// @brief Add a subscription for complete frames of input events matching the specified types and codes
+    /// The input events of a device are accumulated until a SYN_REPORT event and the matching events of the frame
+    /// (followed by the SYN_REPORT event) are delivered in a single callback. Frames without matching events are not
+    /// delivered and a frame is discarded when a SYN_DROPPED event is received. The span is only valid during the
+    /// callback. Error events are delivered as a frame with the error event only.
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param frameCallback A callback to be invoked when a frame with events matching the specified event types and codes is received
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    int addFrameSubscription(const InputEventList& eventTypes, const InputEventList& eventCodes, const InputEventFrameCallback& frameCallback)
+    {
+        if (!frameCallback)
+            return -EINVAL;
+
+        return addFrameSubscription<InputEventFrameCallback>(eventTypes, eventCodes, frameCallback);
+    }
+
+    /// @brief Add a subscription for complete frames of input events with a callable stored by value
+    /// Behaves as the InputEventFrameCallback overload without the indirection of std::function.
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param frameCallback A callable invocable with an InputEventSpan for frames with matching events
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    template <typename Callback, typename = std::enable_if_t<IsInputEventFrameCallback<Callback>>>
+    int addFrameSubscription(const InputEventList& eventTypes, const InputEventList& eventCodes, Callback frameCallback)
+    {
+        if constexpr (std::is_pointer_v<Callback>) {
+            if (!frameCallback)
+                return -EINVAL;
+        }
+
+        if (!validSubscription(eventTypes, eventCodes))
+            return -EINVAL;
+
+        return insertSubscription(std::make_unique<FrameSubscription<InputEventFilter, Callback>>(InputEventFilter(eventTypes, eventCodes), std::move(frameCallback)));
+    }
+
+    /// @brief Add a subscription for batches of input events matching the specified types and codes
+    /// Each batch read from a device (up to InputEventBatchSize events with InputEventOptions::batchedRead) with at
+    /// least one matching event is delivered in a single callback as a view of the read buffer and the indices of the
+    /// matching events, so the input events are not copied. The view is only valid during the callback. The input
+    /// events synthesized when resynchronizing a device are delivered in batches of up to InputEventBatchSize events as
+    /// well. Error events are delivered as a batch with the error event only.
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param batchCallback A callback to be invoked when a batch with events matching the specified event types and codes is received
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    int addBatchSubscription(const InputEventList& eventTypes, const InputEventList& eventCodes, const InputEventBatchCallback& batchCallback)
+    {
+        if (!batchCallback)
+            return -EINVAL;
+
+        return addBatchSubscription<InputEventBatchCallback>(eventTypes, eventCodes, batchCallback);
+    }
+
+    /// @brief Add a subscription for batches of input events with a callable stored by value
+    /// Behaves as the InputEventBatchCallback overload without the indirection of std::function.
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param batchCallback A callable invocable with a const InputEventBatch& for batches with matching events
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    template <typename Callback, typename = std::enable_if_t<IsInputEventBatchCallback<Callback>>>
+    int addBatchSubscription(const InputEventList& eventTypes, const InputEventList& eventCodes, Callback batchCallback)
+    {
+        if constexpr (std::is_pointer_v<Callback>) {
+            if (!batchCallback)
+                return -EINVAL;
+        }
+
+        if (!validSubscription(eventTypes, eventCodes))
+            return -EINVAL;
+
+        return insertSubscription(std::make_unique<BatchSubscription<InputEventFilter, Callback>>(InputEventFilter(eventTypes, eventCodes), std::move(batchCallback)));
+    }
+
+    /// @brief Subscribe for input events matching a filter with a callable stored by value
+    /// @param eventFilter An InputEventFilter or StaticFilter specifying the event types and codes to subscribe for
+    /// @param eventCallback A callable invocable with a const input_event& (or a copy as input_event&) for events matching the filter
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    template <typename Filter, typename Callback, typename = std::enable_if_t<std::is_convertible_v<Filter, InputEventFilter> && IsInputEventCallback<Callback>>>
+    int subscribe(Filter eventFilter, Callback eventCallback)
+    {
+        int result = addSubscription(std::move(eventFilter), std::move(eventCallback));
+        return result < 0 ? result : 0;
+    }
+
+    /// @brief Add a subscription for input events matching a filter with a callable stored by value
+    /// With a StaticFilter the match is resolved at compile time and inlined together with the callable. Otherwise it
+    /// behaves as the overload taking event types and codes.
+    /// @param eventFilter An InputEventFilter or StaticFilter specifying the event types and codes to subscribe for
+    /// @param eventCallback A callable invocable with a const input_event& (or a copy as input_event&) for events matching the filter
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    template <typename Filter, typename Callback, typename = std::enable_if_t<std::is_convertible_v<Filter, InputEventFilter> && IsInputEventCallback<Callback>>>
+    int addSubscription(Filter eventFilter, Callback eventCallback)
+    {
+        if constexpr (std::is_pointer_v<Callback>) {
+            if (!eventCallback)
+                return -EINVAL;
+        }
+
+        return insertSubscription(std::make_unique<CallbackSubscription<Filter, Callback>>(std::move(eventFilter), std::move(eventCallback)));
+    }
+
+    /// @brief Add a subscription for input events matching a filter delivered to a queue
+    /// @note The queue must stay valid until the subscription is removed or the instance is destroyed
+    /// @param eventFilter An InputEventFilter or StaticFilter specifying the event types and codes to subscribe for
+    /// @param eventQueue The InputEventQueue to push input events matching the filter to
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    template <typename Filter, typename = std::enable_if_t<std::is_convertible_v<Filter, InputEventFilter>>>
+    int addSubscription(Filter eventFilter, InputEventQueue& eventQueue)
+    {
+        if (eventQueue.descriptor() < 0)
+            return -EBADF;
+
+        return insertSubscription(std::make_unique<QueueSubscription<Filter>>(std::move(eventFilter), eventQueue));
+    }
+
+    /// @brief Add a subscription for complete frames of input events matching a filter with a callable stored by value
+    /// @param eventFilter An InputEventFilter or StaticFilter specifying the event types and codes to subscribe for
+    /// @param frameCallback A callable invocable with an InputEventSpan for frames with matching events
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    template <typename Filter, typename Callback, typename = std::enable_if_t<std::is_convertible_v<Filter, InputEventFilter> && IsInputEventFrameCallback<Callback>>>
+    int addFrameSubscription(Filter eventFilter, Callback frameCallback)
+    {
+        if constexpr (std::is_pointer_v<Callback>) {
+            if (!frameCallback)
+                return -EINVAL;
+        }
+
+        return insertSubscription(std::make_unique<FrameSubscription<Filter, Callback>>(std::move(eventFilter), std::move(frameCallback)));
+    }
+
+    /// @brief Add a subscription for batches of input events matching a filter with a callable stored by value
+    /// With a StaticFilter the index list is built with the match resolved at compile time.
+    /// @param eventFilter An InputEventFilter or StaticFilter specifying the event types and codes to subscribe for
+    /// @param batchCallback A callable invocable with a const InputEventBatch& for batches with matching events
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    template <typename Filter, typename Callback, typename = std::enable_if_t<std::is_convertible_v<Filter, InputEventFilter> && IsInputEventBatchCallback<Callback>>>
+    int addBatchSubscription(Filter eventFilter, Callback batchCallback)
+    {
+        if constexpr (std::is_pointer_v<Callback>) {
+            if (!batchCallback)
+                return -EINVAL;
+        }
+
+        return insertSubscription(std::make_unique<BatchSubscription<Filter, Callback>>(std::move(eventFilter), std::move(batchCallback)));
+    }
+
+    /// @brief Remove a subscription added with addSubscription, addFrameSubscription or addBatchSubscription
+    /// When the function returns the callback of the subscription will no longer be invoked. The function may be called
+    /// from within a callback.
+    /// @param subscriptionId The subscription id returned by addSubscription, addFrameSubscription or addBatchSubscription
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int removeSubscription(int subscriptionId)
+    {
+        std::shared_ptr<Subscription> subscription;
+        {
+            std::lock_guard<std::recursive_mutex> lock(m_subscriptionMutex);
+
+            auto subscriptions = std::make_shared<SubscriptionList>();
+            for (const auto& entry : *m_subscriptions) {
+                if (entry->id == subscriptionId)
+                    subscription = entry;
+                else
+                    subscriptions->push_back(entry);
+            }
+
+            if (!subscription)
+                return -ENOENT;
+
+            // The subscriptions being dispatched (possibly including this one when called from within a callback) are
+            // kept alive by the dispatching thread, which skips the subscription as it is marked as removed
+            subscription->removed = true;
+            m_frameSubscriptions -= subscription->frames ? 1 : 0;
+            m_subscriptions = std::move(subscriptions);
+        }
+
+        // A callback of the subscription still running on another reader thread is waited for
+        lockSubscription(*subscription);
+
+        subscriptionsChanged();
+        return 0;
+    }
+
+    /// @brief Record all input events read from the input devices with a recorder
+    /// The input events are recorded before they are filtered for the subscriptions. Input events masked in the kernel
+    /// with InputEventOptions::kernelFilter are never read and therefore not recorded.
+    /// @note The recorder must stay valid until it is replaced or the instance is destroyed
+    /// @param recorder A pointer to the InputEventRecorder to record to (or nullptr to stop recording)
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int setRecorder(InputEventRecorder* recorder)
+    {
+        if (recorder && recorder->descriptor() < 0)
+            return -EBADF;
+
+        std::lock_guard<std::recursive_mutex> lock(m_subscriptionMutex);
+        m_recorder = recorder;
+        ++m_recording;
+        return 0;
+    }
+
+    /// @brief Replay a recording through the filters and subscriptions on the calling thread
+    /// The recorded input devices are replayed as separate devices (their state is not visible with value). The input
+    /// events keep their recorded timestamps and are dispatched frame by frame (up to InputEventBatchSize events).
+    /// Values held back by InputEventOptions::debounce and long presses are delivered based on the recorded timestamps.
+    /// The values still held back at the end are delivered, while long presses still held at the end of the recording
+    /// are only recognized if their time has passed by the last recorded input event.
+    /// @note It must not be called from within a callback
+    /// @param replayer The InputEventReplayer with the recording to replay (from its current position)
+    /// @param speed The speed factor relative to the original timing (default 1.0 or 0 for maximum speed)
+    /// @return An int with the result (the number of input events replayed on success or or a negative value from errno.h)
+    int replay(InputEventReplayer& replayer, double speed = 1.0)
+    {
+        if (replayer.descriptor() < 0)
+            return -EBADF;
+
+        std::vector<std::unique_ptr<Device>> devices;
+        std::vector<input_event> batch;
+        batch.reserve(InputEventBatchSize);
+        size_t batchDevice = 0;
+        size_t index;
+        input_event event;
+        int count = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        int64_t firstTime = 0;
+        int64_t lastTime = 0;
+
+        auto flush = [&]() {
+            if (!batch.empty()) {
+                dispatch(*devices[batchDevice], batch.data(), batch.size());
+                batch.clear();
+            }
+        };
+
+        while (replayer.next(index, event)) {
+            while (devices.size() <= index) {
+                auto device = std::make_unique<Device>();
+                device->descriptor = -1;
+                device->info = replayer.devices()[devices.size()];
+                device->info.index = m_nextDeviceIndex++;
+                device->info.capabilities.add(UINT16_MAX, UINT16_MAX);
+                devices.push_back(std::move(device));
+            }
+
+            if (index != batchDevice || batch.size() == InputEventBatchSize)
+                flush();
+
+            int64_t time = lastTime = eventTime(event);
+            if (!count)
+                firstTime = time;
+            else if (speed > 0 && batch.empty())
+                std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<int64_t>((time - firstTime) / speed)));
+
+            batch.push_back(event);
+            batchDevice = index;
+            ++count;
+
+            if (event.type == EV_SYN && event.code == SYN_REPORT)
+                flush();
+        }
+        flush();
+
+        // The held back values are delivered as they were read, while long presses are only recognized if held until
+        // their deadline within the recording
+        for (const auto& device : devices) {
+            if (device->debouncePending)
+                releaseDebounced(*device, INT64_MAX);
+            if (device->gesturesPending)
+                expireGestures(*device, lastTime);
+        }
+
+        return count;
+    }
+
+    /// @brief Get the identification and capabilities of the opened input devices
+    /// The same information is passed to callbacks accepting an InputEventDeviceInfo, where it is valid until the
+    /// input device is closed (see InputEventOptions::hotPlug).
+    /// @return A std::vector with an InputEventDeviceInfo for each opened input device
+    std::vector<InputEventDeviceInfo> devices()
+    {
+        std::lock_guard<std::mutex> lock(m_deviceMutex);
+
+        std::vector<InputEventDeviceInfo> devices;
+        for (const auto& device : m_devices)
+            devices.push_back(device->info);
+
+        return devices;
+    }
+
+    /// @brief Get the statistics collected with InputEventOptions::collectStats
+    /// The counters are updated by the thread dispatching the input events and read without locking, so the values
+    /// of a snapshot may be from slightly different points in time.
+    /// @return An InputEventStats object with the current statistics
+    InputEventStats stats() const
+    {
+        InputEventStats stats;
+        stats.events = m_stats.events.load(std::memory_order_relaxed);
+        stats.batches = m_stats.batches.load(std::memory_order_relaxed);
+        stats.filtered = m_stats.filtered.load(std::memory_order_relaxed);
+        stats.deliveries = m_stats.deliveries.load(std::memory_order_relaxed);
+        stats.dropped = m_stats.dropped.load(std::memory_order_relaxed);
+        stats.debounced = m_stats.debounced.load(std::memory_order_relaxed);
+        stats.oversizedFrames = m_stats.oversizedFrames.load(std::memory_order_relaxed);
+        stats.callbackTime = m_stats.callbackTime.load(std::memory_order_relaxed);
+        stats.maxCallbackTime = m_stats.maxCallbackTime.load(std::memory_order_relaxed);
+        for (size_t bucket = 0; bucket < InputEventLatencyBuckets; ++bucket)
+            stats.latency[bucket] = m_stats.latency[bucket].load(std::memory_order_relaxed);
+
+        return stats;
+    }
+
+    /// @brief Get the backend in use, which differs from InputEventOptions::backend if io_uring is not available
+    /// @return An InputEventBackend with the backend used for waiting for and reading input events
+    InputEventBackend backend() const
+    {
+        return m_backend;
+    }
+
+    /// @brief Get the descriptor to wait for when InputEventOptions::externalDispatch is enabled
+    /// The descriptor (an epoll instance with the input devices) becomes readable when input events are pending and
+    /// can be added to the event loop of the application (e.g. epoll, poll, glib or asio).
+    /// @return An int with the descriptor (or a negative value if not available)
+    int descriptor() const
+    {
+        return m_options.externalDispatch ? m_epollDescriptor : -1;
+    }
+
+    /// @brief Grab or release an opened input device (using EVIOCGRAB)
+    /// While grabbed the input events of the device are only delivered to this instance and not to other readers.
+    /// @param path The path the input device was opened from (see InputEventDeviceInfo::path)
+    /// @param grab Grab the input device if true or release it if false (default true)
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int grabDevice(const std::string& path, bool grab = true)
+    {
+        std::lock_guard<std::mutex> lock(m_deviceMutex);
+
+        auto device = std::find_if(m_devices.begin(), m_devices.end(), [&path](const auto& entry) { return entry->info.path == path; });
+        if (device == m_devices.end())
+            return -ENOENT;
+
+        if (ioctl((*device)->descriptor, EVIOCGRAB, grab ? 1 : 0) < 0)
+            return -errno;
+
+        return 0;
+    }
+
+    /// @brief Close an opened input device until it is reopened (e.g. to hand it over to another process)
+    /// The input device is closed by the worker thread (or by the next InputEvent::dispatch with externalDispatch)
+    /// before it reads the next input events and is not opened again when hot plugged until reopenDevice is called.
+    /// @param path The path the input device was opened from (see InputEventDeviceInfo::path)
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int closeDevice(const std::string& path)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_deviceMutex);
+            if (std::none_of(m_devices.begin(), m_devices.end(), [&path](const auto& entry) { return entry->info.path == path; }))
+                return -ENOENT;
+        }
+
+        return requestDevice(path, false);
+    }
+
+    /// @brief Open an input device again (closing it first if it is opened)
+    /// The input device is opened like the other input devices (with a new InputEventDeviceInfo::index) by the worker
+    /// thread (or by the next InputEvent::dispatch with externalDispatch). The result is returned if neither of them is
+    /// running and otherwise a failure is reported as an error event.
+    /// @param path The path of the input device (e.g. /dev/input/event3)
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int reopenDevice(const std::string& path)
+    {
+        return requestDevice(path, true);
+    }
+
+    /// @brief Read the pending input events and dispatch them to the subscriptions on the calling thread
+    /// The function does not block and is intended to be called when the descriptor is readable with
+    /// InputEventOptions::externalDispatch enabled. Errors are returned instead of being injected as error events.
+    /// It must not be called from within a callback or from multiple threads at the same time.
+    /// @return An int with the result (the number of input events read on success or or a negative value from errno.h)
+    int dispatch()
+    {
+        if (!m_options.externalDispatch)
+            return -EPERM;
+
+        if (m_epollDescriptor < 0)
+            return -EBADF;
+
+        return processInputEvents(0);
+    }
+
+    /// @brief Get current input event value for the specified event type and code
+    /// EV_KEY and EV_SW are supported and with InputEventOptions::cacheState also EV_LED, EV_SND and EV_ABS. For EV_ABS
+    /// the last value of the first device supporting the axis is returned (the value of the last updated slot for
+    /// multitouch axes).
+    /// @param eventType An event type from <linux/input-event-codes.h>
+    /// @param eventCode An event code from <linux/input-event-codes.h>
+    /// @return An int with the result (event value (0 or 1, or the axis value for EV_ABS) on success or or a negative value from errno.h)
+    int value(uint16_t eventType, uint16_t eventCode)
+    {
+        if (m_options.cacheState)
+            return cachedValue(eventType, eventCode);
+
+        std::lock_guard<std::mutex> lock(m_deviceMutex);
+
+        if (m_devices.empty())
+            return -EBADF;
+
+        int eventValue = 0;
+        std::vector<uint8_t> eventCodeBits((eventCode / 8) + 1);
+
+        for (const auto& device : m_devices) {
+            int result = -ENOTSUP;
+
+            switch (eventType) {
+            case EV_KEY:
+                result = ioctl(device->descriptor, EVIOCGKEY(eventCodeBits.size()), eventCodeBits.data());
+                break;
+            case EV_SW:
+                result = ioctl(device->descriptor, EVIOCGSW(eventCodeBits.size()), eventCodeBits.data());
+                break;
+            default:
+                return result;
+            }
+
+            if (result < 0)
+                return -errno;
+
+            eventValue |= (eventCodeBits[eventCode / 8] >> (eventCode % 8)) & 1;
+        }
+
+        return eventValue;
+    }
+
+    /// @brief Get current input event values for all event codes of the specified event type combined for all devices
+    /// The state is fetched with a single ioctl per device (or read from the cached state with
+    /// InputEventOptions::cacheState) instead of one ioctl per device and event code as with value.
+    /// @param eventType One of EV_KEY, EV_SW, EV_LED or EV_SND from <linux/input-event-codes.h>
+    /// @param[out] eventBits A reference to an InputEventBits object where a bit is set if the event code is active on any device
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int values(uint16_t eventType, InputEventBits& eventBits)
+    {
+        std::lock_guard<std::mutex> lock(m_deviceMutex);
+
+        if (m_devices.empty())
+            return -EBADF;
+
+        StateBits combinedBits {};
+
+        for (const auto& device : m_devices) {
+            StateBits bits;
+            int result = deviceState(*device, eventType, bits);
+            if (result < 0)
+                return result;
+
+            for (size_t word = 0; word < bits.size(); ++word)
+                combinedBits[word] |= bits[word];
+        }
+
+        toEventBits(combinedBits, eventBits);
+        return 0;
+    }
+
+    /// @brief Get current input event values for all event codes of the specified event type for each device
+    /// @param eventType One of EV_KEY, EV_SW, EV_LED or EV_SND from <linux/input-event-codes.h>
+    /// @param[out] deviceBits A reference to a std::vector resized to the number of devices with the state of each device
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int values(uint16_t eventType, std::vector<InputEventBits>& deviceBits)
+    {
+        std::lock_guard<std::mutex> lock(m_deviceMutex);
+
+        if (m_devices.empty())
+            return -EBADF;
+
+        deviceBits.resize(m_devices.size());
+
+        for (size_t index = 0; index < m_devices.size(); ++index) {
+            StateBits bits;
+            int result = deviceState(*m_devices[index], eventType, bits);
+            if (result < 0)
+                return result;
+
+            toEventBits(bits, deviceBits[index]);
+        }
+
+        return 0;
+    }
+
+private:
+    /// The maximum number of ready descriptors returned by a single epoll_wait() call
+    static constexpr int MaxReadyDescriptors = 32;
+
+    /// The event types with a state which can be queried from a device and the number of codes of each type
+    static constexpr std::array<uint16_t, 4> StateTypes { EV_KEY, EV_SW, EV_LED, EV_SND };
+    static constexpr std::array<uint16_t, 4> StateCodes { KEY_CNT, SW_CNT, LED_CNT, SND_CNT };
+
+    /// A bitmap large enough for the state of any of the StateTypes in the layout used by the EVIOCG* ioctls
+    using StateBits = std::array<uint64_t, (KEY_CNT + 63) / 64>;
+
+    struct Reader;
+
+    /// @brief A request for closing or reopening an input device (see InputEvent::closeDevice and InputEvent::reopenDevice)
+    struct DeviceRequest {
+        std::string path;
+        bool open;
+    };
+
+    /// @brief The debounce state of an event code of an input device
+    struct DebounceState {
+        /// Set when a value has been delivered
+        bool delivered = false;
+        /// The last delivered value and the kernel timestamp of its input event in microseconds
+        int32_t value = 0;
+        int64_t time = 0;
+        /// The kernel timestamp of the last delivered key press or repeat event in microseconds
+        int64_t repeatTime = 0;
+        /// Set when a value is held back until the deadline in microseconds
+        bool pending = false;
+        int32_t pendingValue = 0;
+        int64_t deadline = 0;
+    };
+
+    /// @brief The recognition state of a gesture for an input device
+    struct GestureState {
+        /// The kernel timestamp of the last press (or the first press of a chord) in microseconds
+        int64_t time = 0;
+        /// Set when the first press of a double press has been seen
+        bool pressed = false;
+        /// The codes of a chord currently held and whether the chord has been recognized since the last release
+        uint64_t held = 0;
+        bool recognized = false;
+        /// The kernel timestamp a held long press is recognized at in microseconds (or 0 when not held)
+        int64_t deadline = 0;
+    };
+
+    /// @brief An opened input device
+    struct Device {
+        int descriptor;
+        /// The input events of the current frame (only used with frame subscriptions) and whether the input events
+        /// are discarded until the next SYN_REPORT event as the frame exceeded InputEventMaxFrameSize
+        std::vector<input_event> frame;
+        bool frameOversized = false;
+        /// The last known state of each of the StateTypes (only used with resynchronization or the state cache). It is
+        /// only written by the worker thread and may be read from any thread.
+        std::array<std::array<std::atomic<uint64_t>, std::tuple_size<StateBits>::value>, StateTypes.size()> state {};
+        /// The absolute axes supported by the device and their last known values (only used with the state cache)
+        std::bitset<ABS_CNT> absAxes;
+        std::array<std::atomic<int32_t>, ABS_CNT> absValues {};
+        /// Set when a SYN_DROPPED event has been received until the next SYN_REPORT event
+        bool dropped = false;
+        /// Set when the descriptor is registered with the wait mechanism
+        bool monitored = false;
+        /// Set while the device is not monitored as no subscription matches its capabilities (see filterDevices)
+        bool filtered = false;
+        /// Set when the capabilities could not be read, so the device is always monitored
+        bool capabilitiesUnknown = false;
+        /// The recording (see setRecorder) the device has been added to and the index of the device in the recording
+        size_t recording = 0;
+        int recordIndex = -1;
+        /// The identification and capabilities of the device passed to the callbacks
+        InputEventDeviceInfo info;
+        /// The debounce state of each event code with a matching InputEventOptions::debounce entry, the number of
+        /// held back values, the earliest deadline of them and whether input events of the current frame have been
+        /// held back or delivered
+        std::unordered_map<uint32_t, DebounceState> debounce;
+        size_t debouncePending = 0;
+        int64_t debounceDeadline = INT64_MAX;
+        bool frameDebounced = false;
+        bool frameDelivered = false;
+        /// The recognition state of each of the InputEventOptions::gestures and the number of held long presses
+        std::vector<GestureState> gestures;
+        size_t gesturesPending = 0;
+        /// Scratch buffers for the input events synthesized or copied while dispatching the input events of the device,
+        /// which are only used by the thread reading the device
+        std::vector<input_event> frameEvents;
+        std::vector<input_event> resyncEvents;
+        std::vector<input_event> debounceEvents;
+        std::vector<input_event> gestureEvents;
+        /// The additional reader thread reading the device (or nullptr for the worker thread)
+        Reader* reader = nullptr;
+    };
+
+    /// @brief The timer for the held back values and long presses of the devices read by a thread
+    struct Timer {
+        int descriptor = -1;
+        /// The time the timer expires at in microseconds (or 0 when it is not armed)
+        int64_t deadline = 0;
+    };
+
+    /// @brief An additional reader thread with the input devices it reads (see InputEventOptions::readerThreads)
+    struct Reader {
+        int epollDescriptor = -1;
+        Timer timer;
+        std::thread thread;
+        /// Held while reading the ready devices and while opening or closing a device of the reader
+        std::recursive_mutex mutex;
+        /// The devices of the reader indexed by descriptor
+        std::vector<Device*> devices;
+    };
+
+    /// @brief Get the index of an event type in StateTypes
+    /// @param eventType An event type from <linux/input-event-codes.h>
+    /// @return An int with the index (or -1 if the event type has no state)
+    static int stateIndex(uint16_t eventType)
+    {
+        switch (eventType) {
+        case EV_KEY:
+            return 0;
+        case EV_SW:
+            return 1;
+        case EV_LED:
+            return 2;
+        case EV_SND:
+            return 3;
+        default:
+            return -1;
+        }
+    }
+
+    /// @brief Queries the current state of an event type from an input descriptor
+    /// @param descriptor The input descriptor to query
+    /// @param eventType One of EV_KEY, EV_SW, EV_LED or EV_SND
+    /// @param[out] bits A pointer to a bitmap to store the state
+    /// @param size The size of the bitmap in bytes
+    /// @return An int with the result (see ioctl.h)
+    static int queryState(int descriptor, uint16_t eventType, void* bits, size_t size)
+    {
+        switch (eventType) {
+        case EV_KEY:
+            return ioctl(descriptor, EVIOCGKEY(size), bits);
+        case EV_SW:
+            return ioctl(descriptor, EVIOCGSW(size), bits);
+        case EV_LED:
+            return ioctl(descriptor, EVIOCGLED(size), bits);
+        case EV_SND:
+            return ioctl(descriptor, EVIOCGSND(size), bits);
+        default:
+            errno = ENOTSUP;
+            return -1;
+        }
+    }
+
+    /// The filter stored by a subscription, with runtime filters compiled for selecting whole batches
+    template <typename Filter>
+    using SubscriptionFilter = std::conditional_t<std::is_same_v<Filter, InputEventFilter>, InputEventFilterKernel, Filter>;
+
+    /// @brief A subscription added with addSubscription, addFrameSubscription or addBatchSubscription
+    struct Subscription {
+        virtual ~Subscription() = default;
+
+        /// @brief Dispatches a batch of input events to the subscription
+        /// @param device The input device the input events were read from
+        /// @param events A pointer to the input events to dispatch
+        /// @param count The number of input events to dispatch
+        /// @return A size_t with the number of input events delivered
+        virtual size_t dispatch(const InputEventDeviceInfo& device, input_event* events, size_t count)
+        {
+            (void)device;
+            (void)events;
+            (void)count;
+            return 0;
+        }
+
+        /// @brief Dispatches a complete frame to the subscription
+        /// @param device The input device the frame was read from
+        /// @param frame The input events of the frame terminated by a SYN_REPORT event
+        /// @param frameEvents A scratch std::vector used for frames with events not matching the subscription
+        virtual void dispatchFrame(const InputEventDeviceInfo& device, const std::vector<input_event>& frame, std::vector<input_event>& frameEvents)
+        {
+            (void)device;
+            (void)frame;
+            (void)frameEvents;
+        }
+
+        /// @brief Dispatches an error event to the subscription
+        /// @param device The placeholder input device of error events (with index -1)
+        /// @param event The error event to dispatch
+        virtual void dispatchError(const InputEventDeviceInfo& device, input_event& event) = 0;
+
+        /// @brief Adds the event types and codes of the subscription to a filter
+        /// @param filter The InputEventFilter to add to
+        virtual void mergeFilter(InputEventFilter& filter) const = 0;
+
+        int id = 0;
+        std::atomic<bool> removed { false };
+        bool frames = false;
+        /// Serializes the invocations of the subscription with InputEventOptions::concurrentCallbacks
+        std::recursive_mutex mutex;
+    };
+
+    using SubscriptionList = std::vector<std::shared_ptr<Subscription>>;
+
+    /// @brief A subscription invoking a callable for each matching input event
+    template <typename Filter, typename Callback>
+    struct CallbackSubscription : Subscription {
+        CallbackSubscription(Filter filter, Callback callback)
+            : filter(std::move(filter))
+            , callback(std::move(callback))
+        {
+        }
+
+        size_t dispatch(const InputEventDeviceInfo& device, input_event* events, size_t count) override
+        {
+            std::array<uint32_t, InputEventBatchSize> indices;
+            size_t delivered = 0;
+
+            // The subscription may be removed from within the callback
+            for (size_t offset = 0; offset < count && !removed; offset += indices.size()) {
+                size_t size = filter.select(events + offset, std::min(count - offset, indices.size()), indices.data());
+                for (size_t index = 0; index < size && !removed; ++index) {
+                    deliver(device, events[offset + indices[index]]);
+                    ++delivered;
+                }
+            }
+
+            return delivered;
+        }
+
+        void dispatchError(const InputEventDeviceInfo& device, input_event& event) override
+        {
+            deliver(device, event);
+        }
+
+        /// @brief Invokes the callable with the input event, which is in the buffer shared by all subscriptions
+        /// Callables taking the input event by mutable reference are passed a copy, so they can not modify the input
+        /// event seen by the following subscriptions.
+        void deliver(const InputEventDeviceInfo& device, const input_event& event)
+        {
+            if constexpr (std::is_invocable_v<Callback&, const input_event&, const InputEventDeviceInfo&>)
+                callback(event, device);
+            else if constexpr (std::is_invocable_v<Callback&, const input_event&>)
+                callback(event);
+            else {
+                input_event copy = event;
+                if constexpr (std::is_invocable_v<Callback&, input_event&, const InputEventDeviceInfo&>)
+                    callback(copy, device);
+                else
+                    callback(copy);
+            }
+        }
+
+        void mergeFilter(InputEventFilter& other) const override
+        {
+            other.merge(filter);
+        }
+
+        SubscriptionFilter<Filter> filter;
+        Callback callback;
+    };
+
+    /// @brief A subscription pushing matching input events to a queue which is notified once per batch
+    template <typename Filter>
+    struct QueueSubscription : Subscription {
+        QueueSubscription(Filter filter, InputEventQueue& queue)
+            : filter(std::move(filter))
+            , queue(queue)
+        {
+        }
+
+        size_t dispatch(const InputEventDeviceInfo&, input_event* events, size_t count) override
+        {
+            std::array<uint32_t, InputEventBatchSize> indices;
+            size_t pushed = 0;
+
+            for (size_t offset = 0; offset < count; offset += indices.size()) {
+                size_t size = filter.select(events + offset, std::min(count - offset, indices.size()), indices.data());
+                for (size_t index = 0; index < size; ++index)
+                    queue.push(events[offset + indices[index]]);
+                pushed += size;
+            }
+
+            if (pushed)
+                queue.notify();
+
+            return pushed;
+        }
+
+        void dispatchError(const InputEventDeviceInfo&, input_event& event) override
+        {
+            queue.push(event);
+            queue.notify();
+        }
+
+        void mergeFilter(InputEventFilter& other) const override
+        {
+            other.merge(filter);
+        }
+
+        SubscriptionFilter<Filter> filter;
+        InputEventQueue& queue;
+    };
+
+    /// @brief A subscription invoking a callable for each complete frame with matching input events
+    template <typename Filter, typename Callback>
+    struct FrameSubscription : Subscription {
+        FrameSubscription(Filter filter, Callback callback)
+            : filter(std::move(filter))
+            , callback(std::move(callback))
+        {
+            frames = true;
+        }
+
+        void dispatchFrame(const InputEventDeviceInfo& device, const std::vector<input_event>& frame, std::vector<input_event>& frameEvents) override
+        {
+            frameEvents.clear();
+            for (size_t index = 0; index + 1 < frame.size(); ++index) {
+                if (filter.matches(frame[index]))
+                    frameEvents.push_back(frame[index]);
+            }
+
+            if (frameEvents.empty())
+                return;
+
+            // Deliver the frame without copying when all events are matching
+            if (frameEvents.size() + 1 == frame.size())
+                deliver(device, { frame.data(), frame.size() });
+            else {
+                frameEvents.push_back(frame.back());
+                deliver(device, { frameEvents.data(), frameEvents.size() });
+            }
+        }
+
+        void dispatchError(const InputEventDeviceInfo& device, input_event& event) override
+        {
+            deliver(device, { &event, 1 });
+        }
+
+        void deliver(const InputEventDeviceInfo& device, InputEventSpan frame)
+        {
+            if constexpr (std::is_invocable_v<Callback&, InputEventSpan, const InputEventDeviceInfo&>)
+                callback(frame, device);
+            else
+                callback(frame);
+        }
+
+        void mergeFilter(InputEventFilter& other) const override
+        {
+            other.merge(filter);
+        }
+
+        Filter filter;
+        Callback callback;
+    };
+
+    /// @brief A subscription delivering the batches of input events with matching events to a callable
+    template <typename Filter, typename Callback>
+    struct BatchSubscription : Subscription {
+        BatchSubscription(Filter filter, Callback callback)
+            : filter(std::move(filter))
+            , callback(std::move(callback))
+        {
+        }
+
+        size_t dispatch(const InputEventDeviceInfo& device, input_event* events, size_t count) override
+        {
+            size_t delivered = 0;
+
+            // The input events synthesized when resynchronizing a device may exceed the read buffer capacity and are
+            // delivered in batches of up to InputEventBatchSize events
+            for (size_t offset = 0; offset < count && !removed; offset += indices.size()) {
+                size_t batchSize = std::min(count - offset, indices.size());
+                size_t size = filter.select(events + offset, batchSize, indices.data());
+                if (!size)
+                    continue;
+
+                deliver(device, { { events + offset, batchSize }, indices.data(), size });
+                delivered += size;
+            }
+
+            return delivered;
+        }
+
+        void dispatchError(const InputEventDeviceInfo& device, input_event& event) override
+        {
+            static const uint32_t index = 0;
+            deliver(device, { { &event, 1 }, &index, 1 });
+        }
+
+        void deliver(const InputEventDeviceInfo& device, const InputEventBatch& batch)
+        {
+            if constexpr (std::is_invocable_v<Callback&, const InputEventBatch&, const InputEventDeviceInfo&>)
+                callback(batch, device);
+            else
+                callback(batch);
+        }
+
+        void mergeFilter(InputEventFilter& other) const override
+        {
+            other.merge(filter);
+        }
+
+        SubscriptionFilter<Filter> filter;
+        Callback callback;
+        /// The indices of the matching input events of the batch being dispatched
+        std::array<uint32_t, InputEventBatchSize> indices;
+    };
+
+    /// @brief Checks the event types and codes of a new subscription
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>
+    /// @return A bool which is true if both lists are non-empty
+    static bool validSubscription(const InputEventList& eventTypes, const InputEventList& eventCodes)
+    {
+        return eventTypes.size() && eventCodes.size();
+    }
+
+    /// @brief Inserts a new subscription and starts the worker thread if needed
+    /// @param subscription The subscription to insert
+    /// @return An int with the result (a positive subscription id on success or a negative value from errno.h)
+    int insertSubscription(std::shared_ptr<Subscription> subscription)
+    {
+        {
+            // The devices are opened and closed by the worker thread while subscriptions are added
+            std::lock_guard<std::mutex> lock(m_deviceMutex);
+            if (m_devices.empty() && m_inotifyDescriptor < 0)
+                return -EBADF;
+        }
+
+        if (m_backend == InputEventBackend::Epoll && m_epollDescriptor < 0)
+            return -EBADF;
+
+        int subscriptionId;
+        {
+            std::lock_guard<std::recursive_mutex> lock(m_subscriptionMutex);
+            subscriptionId = subscription->id = m_nextSubscriptionId++;
+            m_frameSubscriptions += subscription->frames ? 1 : 0;
+
+            // The subscriptions are copied on write, so the dispatching threads keep iterating their own copy
+            auto subscriptions = std::make_shared<SubscriptionList>(*m_subscriptions);
+            subscriptions->push_back(std::move(subscription));
+            m_subscriptions = std::move(subscriptions);
+        }
+
+        subscriptionsChanged();
+        int result = startThread();
+        if (result < 0) {
+            removeSubscription(subscriptionId);
+            return result;
+        }
+
+        return subscriptionId;
+    }
+
+    /// @brief Starts the worker thread if it is not already running
+    /// The thread options are applied by the worker and reader threads before this returns.
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int startThread()
+    {
+        // A callback invoked by the worker or a reader thread can neither join nor replace the threads, so a stopped
+        // worker thread is restarted by the next subscription added from another thread
+        if (m_options.externalDispatch || threadOwner() == this)
+            return 0;
+
+        std::lock_guard<std::mutex> lock(m_threadMutex);
+
+        if (m_thread.joinable()) {
+            if (!m_stopThread.load())
+                return 0;
+
+            // The worker thread has stopped due to an error and is replaced by a new one
+            m_thread.join();
+        }
+
+        m_stopThread.store(false);
+        std::promise<int> started;
+        auto result = started.get_future();
+        m_thread = std::thread([this, started = std::move(started)]() mutable { run(started); });
+
+        // A worker thread failing to apply the thread options exits right away
+        int error = result.get();
+        if (error < 0)
+            m_thread.join();
+        return error;
+    }
+
+    /// @brief Get the InputEvent owning the calling thread as its worker or reader thread
+    /// @return A reference to the pointer to the InputEvent (or nullptr for other threads)
+    static const InputEvent*& threadOwner()
+    {
+        static thread_local const InputEvent* owner = nullptr;
+        return owner;
+    }
+
+    /// @brief Applies the thread options to the calling worker thread
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int configureThread()
+    {
+        int result;
+
+        if (!m_options.threadName.empty() && (result = pthread_setname_np(pthread_self(), m_options.threadName.c_str())))
+            return -result;
+
+        if (m_options.threadAffinity) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (size_t cpu = 0; cpu < 64; ++cpu) {
+                if (m_options.threadAffinity & (uint64_t { 1 } << cpu))
+                    CPU_SET(cpu, &cpus);
+            }
+
+            if ((result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)))
+                return -result;
+        }
+
+        if (m_options.threadPolicy != SCHED_OTHER || m_options.threadPriority) {
+            sched_param param {};
+            param.sched_priority = m_options.threadPriority;
+            if ((result = pthread_setschedparam(pthread_self(), m_options.threadPolicy, &param)))
+                return -result;
+        }
+
+        prefaultStack(m_options.threadStackPrefault);
+        return 0;
+    }
+
+    /// @brief Touches a part of the stack of the calling thread to make it resident
+    /// @param size The number of bytes of the stack to touch
+    __attribute__((noinline)) static void prefaultStack(size_t size)
+    {
+        if (!size)
+            return;
+
+        auto stack = static_cast<volatile char*>(alloca(size));
+        const size_t pageSize = sysconf(_SC_PAGESIZE);
+        for (size_t offset = 0; offset < size; offset += pageSize)
+            stack[offset] = 0;
+    }
+
+    /// @brief The worker thread reading input events and dispatching them to the subscriptions
+    /// @param started The promise to set to the result of applying the thread options to the worker and reader threads
+    void run(std::promise<int>& started)
+    {
+        threadOwner() = this;
+        int result = configureThread();
+
+        std::vector<std::promise<int>> readersStarted(result < 0 ? 0 : m_readers.size());
+        std::vector<std::future<int>> readerResults;
+        for (auto& readerStarted : readersStarted)
+            readerResults.push_back(readerStarted.get_future());
+
+        for (size_t index = 0; index < readersStarted.size(); ++index) {
+            auto& reader = *m_readers[index];
+            auto& readerStarted = readersStarted[index];
+            reader.thread = std::thread([this, &reader, &readerStarted]() { runReader(reader, readerStarted); });
+        }
+
+        for (auto& readerResult : readerResults) {
+            int readerError = readerResult.get();
+            result = result < 0 ? result : readerError;
+        }
+
+        started.set_value(result);
+        if (result < 0) {
+            m_stopThread.store(true);
+            stopReaders();
+            return;
+        }
+
+        while (!m_stopThread.load()) {
+            result = processInputEvents(m_waitTimeout);
+            if (result < 0) {
+                input_event event { 0, 0, UINT16_MAX, UINT16_MAX, result };
+                dispatchError(event);
+                m_stopThread.store(true);
+            }
+        }
+
+        stopReaders();
+    }
+
+    /// @brief An additional reader thread with its own epoll instance (see InputEventOptions::readerThreads)
+    /// @param reader The Reader with the input devices to read
+    /// @param started The promise to set to the result of applying the thread options
+    void runReader(Reader& reader, std::promise<int>& started)
+    {
+        threadOwner() = this;
+        int result = configureThread();
+        started.set_value(result);
+        if (result < 0)
+            return;
+
+        std::array<epoll_event, MaxReadyDescriptors> epollEvents;
+        std::array<input_event, InputEventBatchSize> events;
+
+        while (result >= 0 && !m_stopThread.load()) {
+            int ready = epoll_wait(reader.epollDescriptor, epollEvents.data(), epollEvents.size(), -1);
+            if (ready < 0) {
+                if (errno != EINTR)
+                    result = -errno;
+                continue;
+            }
+
+            // Closing a device of the reader waits for the ready devices to be read
+            std::lock_guard<std::recursive_mutex> lock(reader.mutex);
+            bool timer = false;
+
+            for (int index = 0; index < ready; ++index) {
+                int descriptor = epollEvents[index].data.fd;
+                if (descriptor == reader.timer.descriptor) {
+                    timer = true;
+                    continue;
+                }
+
+                auto device = static_cast<size_t>(descriptor) < reader.devices.size() ? reader.devices[descriptor] : nullptr;
+                if (!device)
+                    continue;
+
+                // A removed device is closed by the worker thread when handling the inotify event
+                int count = 0;
+                if (readDevice(*device, events, count) == -ENODEV)
+                    epoll_ctl(reader.epollDescriptor, EPOLL_CTL_DEL, descriptor, nullptr);
+            }
+
+            if (timer)
+                handleTimer(reader.timer, reader.devices);
+        }
+
+        // Errors are reported like errors of the worker thread, which is stopped as well
+        if (result < 0) {
+            input_event event { 0, 0, UINT16_MAX, UINT16_MAX, result };
+            dispatchError(event);
+            m_stopThread.store(true);
+            wakeup();
+        }
+    }
+
+    /// @brief Creates the epoll instances of the additional reader threads
+    /// If any of them can not be created all input devices are read by the worker thread.
+    void setupReaders()
+    {
+        m_stopDescriptor = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+        for (size_t index = 1; index < m_options.readerThreads && m_stopDescriptor >= 0; ++index) {
+            auto reader = std::make_unique<Reader>();
+            reader->epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+            m_readers.push_back(std::move(reader));
+
+            auto& entry = *m_readers.back();
+            if (entry.epollDescriptor < 0 || !addReaderDescriptor(entry, m_stopDescriptor)) {
+                closeReaders();
+                return;
+            }
+
+            if (m_timer.descriptor >= 0) {
+                entry.timer.descriptor = timerfd_create(m_options.clockId, TFD_CLOEXEC | TFD_NONBLOCK);
+                if (entry.timer.descriptor >= 0 && !addReaderDescriptor(entry, entry.timer.descriptor)) {
+                    close(entry.timer.descriptor);
+                    entry.timer.descriptor = -1;
+                }
+            }
+        }
+    }
+
+    /// @brief Closes the epoll instances and timers of the additional reader threads
+    void closeReaders()
+    {
+        for (const auto& reader : m_readers) {
+            if (reader->timer.descriptor >= 0)
+                close(reader->timer.descriptor);
+            if (reader->epollDescriptor >= 0)
+                close(reader->epollDescriptor);
+        }
+        m_readers.clear();
+
+        if (m_stopDescriptor >= 0) {
+            close(m_stopDescriptor);
+            m_stopDescriptor = -1;
+        }
+    }
+
+    /// @brief Stops the additional reader threads after the worker thread has been stopped
+    void stopReaders()
+    {
+        if (m_readers.empty())
+            return;
+
+        // The stop descriptor stays readable until all reader threads have seen it and is reset for a restart
+        uint64_t value = 1;
+        [[maybe_unused]] auto result = write(m_stopDescriptor, &value, sizeof(value));
+
+        for (auto& reader : m_readers) {
+            if (reader->thread.joinable())
+                reader->thread.join();
+        }
+
+        result = read(m_stopDescriptor, &value, sizeof(value));
+    }
+
+    /// @brief Registers a descriptor with the epoll instance of a reader thread
+    /// @param reader The Reader to register the descriptor with
+    /// @param descriptor The descriptor to register
+    /// @return A bool which is true if the descriptor could be registered
+    static bool addReaderDescriptor(Reader& reader, int descriptor)
+    {
+        epoll_event epollEvent {};
+        epollEvent.events = EPOLLIN;
+        epollEvent.data.fd = descriptor;
+        return epoll_ctl(reader.epollDescriptor, EPOLL_CTL_ADD, descriptor, &epollEvent) == 0;
+    }
+
+    /// @brief Registers a device with the wait mechanism of the thread reading it
+    /// @param device The device to register
+    /// @return A bool which is true if the device could be registered
+    bool registerDevice(Device& device)
+    {
+        if (!device.reader)
+            return registerDescriptor(device.descriptor);
+
+        return addReaderDescriptor(*device.reader, device.descriptor);
+    }
+
+    /// @brief Unregisters a device from the wait mechanism of the thread reading it
+    /// @param device The device to unregister
+    void unregisterDevice(Device& device)
+    {
+        if (!device.reader)
+            unregisterDescriptor(device.descriptor);
+        else
+            epoll_ctl(device.reader->epollDescriptor, EPOLL_CTL_DEL, device.descriptor, nullptr);
+    }
+
+    /// @brief Reads the pending input events of a device and dispatches them to the subscriptions
+    /// @param device The device to read
+    /// @param events The buffer to read the input events into
+    /// @param[in,out] count The number of input events read
+    /// @return An int with the result of the last read (0 on success or a negative value from errno.h)
+    int readDevice(Device& device, std::array<input_event, InputEventBatchSize>& events, int& count)
+    {
+        const ssize_t readSize = m_options.batchedRead ? sizeof(events) : sizeof(input_event);
+        ssize_t bytes;
+
+        // In batched mode keep reading as long as the buffer is filled completely, as a partial read
+        // means that the device has been drained (or returned EAGAIN on a non-blocking descriptor)
+        do {
+            bytes = read(device.descriptor, events.data(), readSize);
+            if (bytes > 0) {
+                count += bytes / sizeof(input_event);
+                dispatch(device, events.data(), bytes / sizeof(input_event));
+            }
+        } while (m_options.batchedRead && bytes == readSize);
+
+        return bytes < 0 ? -errno : 0;
+    }
+
+    /// @brief Waits for input events, reads them from the ready devices and dispatches them to the subscriptions
+    /// @param timeout The maximum time to wait in milliseconds (0 to return immediately or -1 to wait indefinitely)
+    /// @return An int with the result (the number of input events read on success or a negative value from errno.h)
+    int processInputEvents(int timeout)
+    {
+        std::array<input_event, InputEventBatchSize> events;
+
+        if (m_updateDevices.exchange(false))
+            updateDeviceFilters();
+
+        if (m_deviceRequestsPending.exchange(false))
+            handleDeviceRequests();
+
+        if (m_backend == InputEventBackend::IoUring)
+            return processRingEvents(timeout);
+
+        m_readyDescriptors.clear();
+        if (waitForInputEvent(m_readyDescriptors, timeout) < 0)
+            return -errno;
+
+        int count = 0;
+        bool hotPlug = false;
+        bool debounce = false;
+
+        for (auto descriptor : m_readyDescriptors) {
+            if (descriptor == m_inotifyDescriptor) {
+                hotPlug = true;
+                continue;
+            }
+
+            if (descriptor == m_timer.descriptor) {
+                debounce = true;
+                continue;
+            }
+
+            auto device = static_cast<size_t>(descriptor) < m_descriptorDevices.size() ? m_descriptorDevices[descriptor] : nullptr;
+            if (!device)
+                continue;
+
+            // A removed device is closed right away instead of waiting for the inotify event
+            if (readDevice(*device, events, count) == -ENODEV)
+                closeDevice(*device);
+        }
+
+        if (debounce)
+            handleTimer(m_timer, m_descriptorDevices);
+
+        // The devices are updated after reading to not invalidate the devices with pending input events
+        if (hotPlug)
+            handleHotPlug();
+
+        return count;
+    }
+
+    /// @brief Resolves the options which depend on each other
+    /// @param options The options specified by the application
+    /// @return An InputEventOptions object with the options to use
+    static InputEventOptions resolveOptions(InputEventOptions options)
+    {
+        // A single descriptor can only be exposed for an epoll instance
+        if (options.externalDispatch) {
+            options.backend = InputEventBackend::Epoll;
+            options.readerThreads = 1;
+        }
+
+        // The additional reader threads each wait on their own epoll instance
+        if (options.readerThreads > 1)
+            options.backend = InputEventBackend::Epoll;
+
+        return options;
+    }
+
+    /// @brief Opens an input device and starts monitoring it
+    /// @param path The path of the input device to open
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int openDevice(const std::string& path)
+    {
+        int descriptor = open(path.c_str(), m_openFlags);
+        if (descriptor < 0)
+            return -errno;
+
+        auto device = std::make_shared<Device>();
+        device->descriptor = descriptor;
+        device->frame.reserve(InputEventBatchSize);
+        device->frameEvents.reserve(InputEventBatchSize);
+        if (m_options.resynchronize)
+            device->resyncEvents.reserve(InputEventBatchSize);
+        readDeviceInfo(*device, path);
+
+        // Devices not supporting the clock (or not being an input device) keep their default clock
+        if (m_options.clockId != CLOCK_REALTIME) {
+            int clockId = m_options.clockId;
+            ioctl(descriptor, EVIOCSCLOCKID, &clockId);
+        }
+
+        if (m_options.grab)
+            ioctl(descriptor, EVIOCGRAB, 1);
+
+        if (m_options.resynchronize || m_options.cacheState)
+            initializeState(*device);
+
+        // The devices are distributed evenly across the worker thread and the additional reader threads
+        if (!m_readers.empty()) {
+            size_t reader = m_nextReader++ % (m_readers.size() + 1);
+            device->reader = reader ? m_readers[reader - 1].get() : nullptr;
+        }
+
+        auto& devices = device->reader ? device->reader->devices : m_descriptorDevices;
+        std::unique_lock<std::recursive_mutex> readerLock;
+        if (device->reader)
+            readerLock = std::unique_lock<std::recursive_mutex>(device->reader->mutex);
+
+        if (m_options.filterDevices) {
+            monitorDevice(*device, monitoredDevice(*device));
+        } else if (!(device->monitored = registerDevice(*device))) {
+            int result = -errno;
+            close(descriptor);
+            return result;
+        }
+
+        applyKernelFilter(*device);
+
+        if (devices.size() <= static_cast<size_t>(descriptor))
+            devices.resize(descriptor + 1);
+        devices[descriptor] = device.get();
+        readerLock = {};
+
+        std::lock_guard<std::mutex> lock(m_deviceMutex);
+        m_devices.push_back(std::move(device));
+        publishDevices();
+        return 0;
+    }
+
+    /// @brief Stops monitoring an input device and closes it
+    /// @param device The device to close
+    void closeDevice(Device& device)
+    {
+        // The reader thread of the device is waited for if it is reading the device
+        std::unique_lock<std::recursive_mutex> readerLock;
+        if (device.reader)
+            readerLock = std::unique_lock<std::recursive_mutex>(device.reader->mutex);
+
+        if (device.monitored)
+            unregisterDevice(device);
+        (device.reader ? device.reader->devices : m_descriptorDevices)[device.descriptor] = nullptr;
+        readerLock = {};
+
+        // The descriptor is closed with the device lock held as it is used by grabDevice
+        std::lock_guard<std::mutex> lock(m_deviceMutex);
+        close(device.descriptor);
+        m_devices.erase(std::find_if(m_devices.begin(), m_devices.end(), [&device](const auto& entry) { return entry.get() == &device; }));
+        publishDevices();
+    }
+
+    /// @brief Publishes a copy of the open devices for InputEventOptions::cacheState (with the device lock held)
+    /// A closed device is kept alive by the copies still being read, which only access its cached state.
+    void publishDevices()
+    {
+        if (m_options.cacheState)
+            std::atomic_store(&m_cachedDevices, std::make_shared<const std::vector<std::shared_ptr<Device>>>(m_devices));
+    }
+
+    /// @brief Opens all input devices in the directory of the input event prefix in numerical order
+    void scanDevices()
+    {
+        auto separator = m_inputEventPrefix.rfind('/');
+        auto directory = separator == std::string::npos ? "." : m_inputEventPrefix.substr(0, separator + 1);
+        std::vector<int> numbers;
+
+        DIR* directoryStream = opendir(directory.c_str());
+        if (!directoryStream)
+            return;
+
+        while (auto entry = readdir(directoryStream)) {
+            int number = deviceNumber(entry->d_name);
+            if (number >= 0)
+                numbers.push_back(number);
+        }
+        closedir(directoryStream);
+
+        std::sort(numbers.begin(), numbers.end());
+        for (auto number : numbers)
+            openDevice(m_inputEventPrefix + std::to_string(number));
+    }
+
+    /// @brief Get the number of an input device from its file name
+    /// @param name The file name in the directory of the input event prefix
+    /// @return An int with the number (or -1 if the file name does not match the input event prefix)
+    int deviceNumber(const std::string& name) const
+    {
+        auto separator = m_inputEventPrefix.rfind('/');
+        auto prefix = separator == std::string::npos ? m_inputEventPrefix : m_inputEventPrefix.substr(separator + 1);
+
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0)
+            return -1;
+
+        // The number is appended to the prefix again to open the device, so leading zeros don't match
+        auto number = name.substr(prefix.size());
+        if (number.find_first_not_of("0123456789") != std::string::npos || (number.size() > 1 && number[0] == '0'))
+            return -1;
+
+        int64_t value = 0;
+        for (auto digit : number) {
+            value = value * 10 + (digit - '0');
+            if (value > INT32_MAX)
+                return -1;
+        }
+
+        return static_cast<int>(value);
+    }
+
+    /// @brief Reads the identification and capabilities of a device passed to the callbacks
+    /// @param device The device to read the identification of
+    /// @param path The path the device was opened from
+    void readDeviceInfo(Device& device, const std::string& path)
+    {
+        auto& info = device.info;
+        info.index = m_nextDeviceIndex++;
+        info.path = path;
+
+        char name[256] {};
+        if (ioctl(device.descriptor, EVIOCGNAME(sizeof(name) - 1), name) >= 0)
+            info.name = name;
+
+        char phys[256] {};
+        if (ioctl(device.descriptor, EVIOCGPHYS(sizeof(phys) - 1), phys) >= 0)
+            info.phys = phys;
+
+        ioctl(device.descriptor, EVIOCGID, &info.id);
+        readCapabilities(device);
+    }
+
+    /// @brief Reads the supported event types and codes of a device
+    /// If the capabilities can not be read all event types and codes are considered to be supported.
+    /// @param device The device to read the capabilities of
+    static void readCapabilities(Device& device)
+    {
+        uint64_t typeBits = 0;
+
+        if (ioctl(device.descriptor, EVIOCGBIT(0, sizeof(typeBits)), &typeBits) < 0) {
+            device.info.capabilities.add(UINT16_MAX, UINT16_MAX);
+            device.capabilitiesUnknown = true;
+            return;
+        }
+
+        // All devices produce synchronization events
+        device.info.capabilities.add(EV_SYN, UINT16_MAX);
+
+        for (uint16_t type = 1; type < EV_CNT; ++type) {
+            StateBits codeBits {};
+            if (!((typeBits >> type) & 1) || ioctl(device.descriptor, EVIOCGBIT(type, sizeof(codeBits)), codeBits.data()) < 0)
+                continue;
+
+            for (size_t word = 0; word < codeBits.size(); ++word) {
+                for (uint64_t set = codeBits[word]; set; set &= set - 1)
+                    device.info.capabilities.add(type, static_cast<uint16_t>(word * 64 + __builtin_ctzll(set)));
+            }
+        }
+    }
+
+    /// @brief Checks if a device should be monitored
+    /// @param device The device to check
+    /// @return A bool which is true if the device is not filtered or can produce events matching a subscription
+    bool monitoredDevice(const Device& device) const
+    {
+        return !m_options.filterDevices || m_options.cacheState || device.capabilitiesUnknown || device.info.capabilities.intersects(m_monitorFilter);
+    }
+
+    /// @brief Starts or stops monitoring a device
+    /// The input events of a device which is not monitored are masked in the kernel, so they are not queued for a
+    /// descriptor nobody reads. The input events queued anyway (e.g. without EVIOCSMASK) are discarded when the device
+    /// is monitored again, so a new subscription neither receives stale input events nor the SYN_DROPPED event of the
+    /// overflowed queue.
+    /// @param device The device to update
+    /// @param monitor A bool which is true if the device should be monitored
+    void monitorDevice(Device& device, bool monitor)
+    {
+        if (monitor && !device.monitored) {
+            if (device.filtered) {
+                setTypeMask(device, UINT64_MAX);
+                flushDevice(device);
+                device.filtered = false;
+            }
+            device.monitored = registerDevice(device);
+        } else if (!monitor && !device.filtered) {
+            if (device.monitored) {
+                unregisterDevice(device);
+                device.monitored = false;
+            }
+            setTypeMask(device, 0);
+            device.filtered = true;
+        }
+    }
+
+    /// @brief Sets the event types of a device passed by the kernel (see EVIOCSMASK)
+    /// Failures are ignored as the events are filtered when dispatching them anyway.
+    /// @param device The device to set the event type mask for
+    /// @param typeBits A bit set for each event type to pass (EV_SYN events are always passed)
+    void setTypeMask(const Device& device, uint64_t typeBits)
+    {
+#ifdef EVIOCSMASK
+        input_mask mask { 0, sizeof(typeBits), reinterpret_cast<uintptr_t>(&typeBits) };
+        ioctl(device.descriptor, EVIOCSMASK, &mask);
+#else
+        (void)device;
+        (void)typeBits;
+#endif
+    }
+
+    /// @brief Discards the input events queued for a device while it was not monitored
+    /// The tracked state of the device is read again as the discarded input events may have changed it.
+    /// @param device The device to flush
+    void flushDevice(Device& device)
+    {
+        std::array<input_event, InputEventBatchSize> events;
+        pollfd entry { device.descriptor, POLLIN, 0 };
+        while (poll(&entry, 1, 0) > 0 && (entry.revents & POLLIN)) {
+            if (read(device.descriptor, events.data(), sizeof(events)) <= 0)
+                break;
+        }
+
+        device.dropped = false;
+        if (m_options.resynchronize || m_options.cacheState)
+            initializeState(device);
+    }
+
+    /// @brief Updates the monitored devices and kernel filters from the filters of the current subscriptions
+    void updateDeviceFilters()
+    {
+        {
+            std::lock_guard<std::recursive_mutex> lock(m_subscriptionMutex);
+            InputEventFilter filter;
+            for (const auto& subscription : *m_subscriptions)
+                subscription->mergeFilter(filter);
+
+            // The input events of the gestures are needed even without a subscription for them
+            if (filter.matchesType(InputEventGestureType))
+                filter.merge(m_gestureFilter);
+
+            // The filter is read by the reader threads when collecting statistics
+            m_monitorFilter = filter;
+        }
+
+        for (auto& device : m_devices) {
+            monitorDevice(*device, monitoredDevice(*device));
+            applyKernelFilter(*device);
+        }
+    }
+
+    /// @brief Sets the event mask of a device to the combined filter of the subscriptions
+    /// Failures are ignored as the events are filtered when dispatching them anyway.
+    /// @param device The device to set the event mask for
+    void applyKernelFilter(const Device& device)
+    {
+#ifdef EVIOCSMASK
+        // The input events of a filtered device stay masked completely
+        if (!m_options.kernelFilter || m_options.resynchronize || m_options.cacheState || device.filtered)
+            return;
+
+        uint64_t typeBits = 1 << EV_SYN;
+        for (uint16_t type = EV_SYN + 1; type < EV_CNT; ++type) {
+            if (!m_monitorFilter.matchesType(type))
+                continue;
+
+            StateBits codeBits {};
+            const auto& codes = m_monitorFilter.codes(type);
+            for (size_t code = 0; code < codes.size(); ++code) {
+                if (codes[code])
+                    codeBits[code / 64] |= uint64_t(1) << (code % 64);
+            }
+
+            input_mask mask { type, sizeof(codeBits), reinterpret_cast<uintptr_t>(codeBits.data()) };
+            if (ioctl(device.descriptor, EVIOCSMASK, &mask) < 0)
+                return;
+
+            typeBits |= uint64_t(1) << type;
+        }
+
+        setTypeMask(device, typeBits);
+#else
+        (void)device;
+#endif
+    }
+
+    /// @brief Requests the worker thread to update the device filters after the subscriptions have changed
+    void subscriptionsChanged()
+    {
+        if (m_options.filterDevices || m_options.kernelFilter || m_options.collectStats) {
+            m_updateDevices.store(true);
+            wakeup();
+        }
+    }
+
+    /// @brief Requests closing or reopening an input device from the thread reading the input devices
+    /// The request is handled right away (after waiting for a stopped worker thread to exit) if neither the worker
+    /// thread nor external dispatching can read the devices. Requests made by the callbacks of the worker or reader
+    /// threads are always handled by the worker thread.
+    /// @param path The path of the input device
+    /// @param open Open the input device again after closing it if true
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int requestDevice(const std::string& path, bool open)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_deviceMutex);
+            m_deviceRequests.push_back({ path, open });
+        }
+
+        std::unique_lock<std::mutex> lock(m_threadMutex, std::defer_lock);
+        if (!m_options.externalDispatch && threadOwner() != this) {
+            lock.lock();
+            if (m_thread.joinable() && m_stopThread.load())
+                m_thread.join();
+
+            // The result is returned instead of being reported as an error event while the thread lock is held
+            if (!m_thread.joinable()) {
+                m_deviceRequestsPending.store(false);
+                return handleDeviceRequests(false);
+            }
+        }
+
+        m_deviceRequestsPending.store(true);
+        wakeup();
+        return 0;
+    }
+
+    /// @brief Closes and reopens the requested input devices
+    /// @param reportErrors Report the failed requests as error events if true
+    /// @return An int with the result of the last failed request (0 on success or or a negative value from errno.h)
+    int handleDeviceRequests(bool reportErrors = true)
+    {
+        std::vector<DeviceRequest> requests;
+        {
+            std::lock_guard<std::mutex> lock(m_deviceMutex);
+            requests.swap(m_deviceRequests);
+        }
+
+        int result = 0;
+        for (const auto& request : requests) {
+            Device* device = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(m_deviceMutex);
+                auto found = std::find_if(m_devices.begin(), m_devices.end(), [&request](const auto& entry) { return entry->info.path == request.path; });
+                if (found != m_devices.end())
+                    device = found->get();
+            }
+
+            if (device)
+                closeDevice(*device);
+
+            if (!request.open) {
+                m_closedDevices.insert(request.path);
+                continue;
+            }
+
+            m_closedDevices.erase(request.path);
+            int openResult = openDevice(request.path);
+            if (openResult < 0 && reportErrors) {
+                input_event event { 0, 0, UINT16_MAX, UINT16_MAX, openResult };
+                dispatchError(event);
+            }
+            if (openResult < 0)
+                result = openResult;
+        }
+
+        return result;
+    }
+
+    /// @brief Handles the pending inotify events by opening added and closing removed input devices
+    void handleHotPlug()
+    {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t bytes;
+
+        while ((bytes = read(m_inotifyDescriptor, buffer, sizeof(buffer))) > 0) {
+            for (char* entry = buffer; entry < buffer + bytes;) {
+                auto inotifyEvent = reinterpret_cast<inotify_event*>(entry);
+                entry += sizeof(inotify_event) + inotifyEvent->len;
+
+                auto path = hotPlugPath(inotifyEvent);
+                if (path.empty())
+                    continue;
+
+                auto device = std::find_if(m_devices.begin(), m_devices.end(), [&path](const auto& entry) { return entry->info.path == path; });
+                bool removed = inotifyEvent->mask & (IN_DELETE | IN_MOVED_FROM);
+
+                // Device nodes are typically created before their permissions are updated, so opening is also
+                // retried when the attributes change
+                if (removed && device != m_devices.end())
+                    closeDevice(**device);
+                else if (!removed && device == m_devices.end() && !m_closedDevices.count(path))
+                    openDevice(path);
+            }
+        }
+    }
+
+    /// @brief Get the path of the input device an inotify event refers to
+    /// @param inotifyEvent The inotify event for the watched directory
+    /// @return A std::string with the path (or empty if the inotify event does not refer to a monitored input device)
+    std::string hotPlugPath(const inotify_event* inotifyEvent) const
+    {
+        if (!inotifyEvent->len)
+            return {};
+
+        int number = deviceNumber(inotifyEvent->name);
+        if (number < 0 || (!m_options.scanDirectory && number >= m_maxInputEvents))
+            return {};
+
+        return m_inputEventPrefix + std::to_string(number);
+    }
+
+    /// @brief Dispatches input events to the callbacks of the subscriptions with a matching filter
+    /// @param device The device the input events were read from
+    /// @param events A pointer to the input events to dispatch
+    /// @param count The number of input events to dispatch
+    /// @param synthesized Set for input events synthesized by the debounce and gesture stages (which are not counted,
+    /// recorded or debounced)
+    void dispatch(Device& device, input_event* events, size_t count, bool synthesized = false)
+    {
+        // Long presses which expired before the input events are delivered first to keep their order
+        if (!synthesized && device.gesturesPending)
+            expireGestures(device, eventTime(events[0]));
+
+        // Subscriptions added from within a callback are not dispatched to until the next batch. The lock is only
+        // held for taking the subscriptions, counting against the monitor filter and recording, as the remaining state
+        // belongs to the device and the callbacks are serialized by lockSubscription.
+        std::unique_lock<std::recursive_mutex> lock(m_subscriptionMutex);
+        auto subscriptions = m_subscriptions;
+        if (!synthesized && m_options.collectStats)
+            updateStats(events, count);
+        if (!synthesized && m_recorder)
+            recordEvents(device, events, count);
+        lock.unlock();
+
+        if (synthesized || m_options.debounce.empty()) {
+            dispatchEvents(device, events, count, *subscriptions);
+            return;
+        }
+
+        // Held back values are delivered between the input events before and after their deadline to keep their order
+        for (size_t offset = 0, consumed; offset < count; offset += consumed) {
+            if (device.debouncePending)
+                releaseDebounced(device, eventTime(events[offset]));
+
+            size_t kept = debounceEvents(device, events + offset, count - offset, consumed);
+            if (kept)
+                dispatchEvents(device, events + offset, kept, *subscriptions);
+        }
+    }
+
+    /// @brief Dispatches debounced input events to the state cache, the subscriptions and the gesture recognition
+    /// @param device The device the input events were read from
+    /// @param events A pointer to the input events to dispatch
+    /// @param count The number of input events to dispatch
+    /// @param subscriptions The subscriptions to dispatch to
+    void dispatchEvents(Device& device, input_event* events, size_t count, const SubscriptionList& subscriptions)
+    {
+        if (m_options.resynchronize)
+            events = resynchronizeEvents(device, events, count);
+        else if (m_options.cacheState) {
+            for (size_t index = 0; index < count; ++index)
+                updateState(device, events[index]);
+        }
+
+        for (const auto& subscription : subscriptions) {
+            auto& entry = *subscription;
+            auto entryLock = lockSubscription(entry);
+            if (entry.removed)
+                continue;
+
+            if (!m_options.collectStats) {
+                entry.dispatch(device.info, events, count);
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            size_t delivered = entry.dispatch(device.info, events, count);
+            uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+            m_stats.deliveries.fetch_add(delivered, std::memory_order_relaxed);
+            m_stats.callbackTime.fetch_add(time, std::memory_order_relaxed);
+
+            // The maximum is updated by all reader threads
+            uint64_t maxTime = m_stats.maxCallbackTime.load(std::memory_order_relaxed);
+            while (time > maxTime && !m_stats.maxCallbackTime.compare_exchange_weak(maxTime, time, std::memory_order_relaxed)) { }
+        }
+
+        if (m_frameSubscriptions) {
+            for (size_t index = 0; index < count; ++index)
+                assembleFrame(device, events[index], subscriptions);
+        }
+
+        if (!m_options.gestures.empty())
+            recognizeGestures(device, events, count);
+
+        if (!device.gestureEvents.empty())
+            dispatchGestures(device);
+    }
+
+    /// @brief Locks a subscription for invoking its callback
+    /// @param subscription The subscription to invoke
+    /// @return A std::unique_lock owning the mutex of the subscription with InputEventOptions::concurrentCallbacks (or
+    /// the mutex shared by the callbacks of all subscriptions otherwise)
+    std::unique_lock<std::recursive_mutex> lockSubscription(Subscription& subscription)
+    {
+        return std::unique_lock<std::recursive_mutex>(m_options.concurrentCallbacks ? subscription.mutex : m_callbackMutex);
+    }
+
+    /// @brief Get the kernel timestamp of an input event
+    /// @param event The input event
+    /// @return An int64_t with the timestamp in microseconds
+    static int64_t eventTime(const input_event& event)
+    {
+        return static_cast<int64_t>(event.input_event_sec) * 1000000 + event.input_event_usec;
+    }
+
+    /// @brief Get the InputEventOptions::debounce entry applying to an input event
+    /// @param event The input event
+    /// @return A pointer to the first matching InputEventDebounce (or nullptr if none matches)
+    const InputEventDebounce* debounceRule(const input_event& event) const
+    {
+        for (const auto& rule : m_options.debounce) {
+            if ((rule.type == event.type || (rule.type == UINT16_MAX && event.type != EV_SYN)) && (rule.code == event.code || rule.code == UINT16_MAX))
+                return &rule;
+        }
+
+        return nullptr;
+    }
+
+    /// @brief Debounces and rate limits input events in place until an input event reaches the deadline of a held
+    /// back value
+    /// @param device The device the input events were read from
+    /// @param events A pointer to the input events read
+    /// @param count The number of input events read
+    /// @param[out] consumed A reference to a size_t to store the number of input events debounced
+    /// @return A size_t with the number of input events left to dispatch
+    size_t debounceEvents(Device& device, input_event* events, size_t count, size_t& consumed)
+    {
+        size_t kept = 0;
+        size_t index = 0;
+        for (; index < count; ++index) {
+            const auto& event = events[index];
+            if (index && device.debouncePending && eventTime(event) >= device.debounceDeadline)
+                break;
+
+            bool keep = true;
+
+            if (event.type == EV_SYN) {
+                if (event.code == SYN_REPORT) {
+                    keep = device.frameDelivered || !device.frameDebounced;
+                    device.frameDebounced = false;
+                    device.frameDelivered = false;
+                }
+            } else if (auto rule = debounceRule(event)) {
+                keep = debounceEvent(device, *rule, event);
+                device.frameDebounced |= !keep;
+            }
+
+            if (keep) {
+                device.frameDelivered |= event.type != EV_SYN;
+                events[kept++] = event;
+            }
+        }
+
+        if (m_options.collectStats)
+            m_stats.debounced.fetch_add(index - kept, std::memory_order_relaxed);
+
+        consumed = index;
+        return kept;
+    }
+
+    /// @brief Debounces or rate limits an input event
+    /// @param device The device the input event was read from
+    /// @param rule The InputEventDebounce applying to the input event
+    /// @param event The input event
+    /// @return A bool which is true if the input event is to be dispatched
+    bool debounceEvent(Device& device, const InputEventDebounce& rule, const input_event& event)
+    {
+        auto& state = device.debounce[static_cast<uint32_t>(event.type) << 16 | event.code];
+        int64_t time = eventTime(event);
+
+        // Repeat events are dropped while a value is held back, so no repeat is delivered before its key press
+        if (event.type == EV_KEY && event.value == 2) {
+            if (state.pending || time - state.repeatTime < rule.repeatInterval.count())
+                return false;
+
+            state.repeatTime = time;
+            return true;
+        }
+
+        if (event.type == EV_KEY && event.value == 1)
+            state.repeatTime = time;
+
+        if (rule.window.count() <= 0)
+            return true;
+
+        if (state.pending) {
+            state.pendingValue = event.value;
+            return false;
+        }
+
+        if (state.delivered && state.value == event.value)
+            return false;
+
+        if (state.delivered && time - state.time < rule.window.count()) {
+            state.pending = true;
+            state.pendingValue = event.value;
+            state.deadline = state.time + rule.window.count();
+            device.debounceDeadline = device.debouncePending++ ? std::min(device.debounceDeadline, state.deadline) : state.deadline;
+
+            // Replayed devices only deliver held back values based on the recorded timestamps
+            if (device.descriptor >= 0)
+                armTimer(deviceTimer(device), state.deadline);
+            return false;
+        }
+
+        state.delivered = true;
+        state.value = event.value;
+        state.time = time;
+        return true;
+    }
+
+    /// @brief Delivers the held back values of a device with a deadline until a time followed by a SYN_REPORT event
+    /// @param device The device with held back values
+    /// @param time The kernel timestamp in microseconds to deliver the held back values until
+    void releaseDebounced(Device& device, int64_t time)
+    {
+        device.debounceEvents.clear();
+        device.debounceDeadline = INT64_MAX;
+        for (auto& [key, state] : device.debounce) {
+            if (state.pending && state.deadline > time)
+                device.debounceDeadline = std::min(device.debounceDeadline, state.deadline);
+            if (!state.pending || state.deadline > time)
+                continue;
+
+            state.pending = false;
+            --device.debouncePending;
+            if (state.pendingValue == state.value)
+                continue;
+
+            state.value = state.pendingValue;
+            state.time = state.deadline;
+
+            input_event event {};
+            event.input_event_sec = state.deadline / 1000000;
+            event.input_event_usec = state.deadline % 1000000;
+            event.type = key >> 16;
+            event.code = key & UINT16_MAX;
+            event.value = state.value;
+            device.debounceEvents.push_back(event);
+        }
+
+        if (device.debounceEvents.empty())
+            return;
+
+        std::sort(device.debounceEvents.begin(), device.debounceEvents.end(), [](const auto& first, const auto& second) { return eventTime(first) < eventTime(second); });
+        input_event report = device.debounceEvents.back();
+        report.type = EV_SYN;
+        report.code = SYN_REPORT;
+        report.value = 0;
+        device.debounceEvents.push_back(report);
+
+        dispatch(device, device.debounceEvents.data(), device.debounceEvents.size(), true);
+    }
+
+    /// @brief Advances the gesture recognition of a device with input events
+    /// @param device The device the input events were read from
+    /// @param events A pointer to the input events dispatched
+    /// @param count The number of input events dispatched
+    void recognizeGestures(Device& device, const input_event* events, size_t count)
+    {
+        device.gestures.resize(m_options.gestures.size());
+
+        for (size_t index = 0; index < count; ++index) {
+            const auto& event = events[index];
+            if (!m_gestureFilter.matches(event) || event.value == 2)
+                continue;
+
+            for (size_t gesture = 0; gesture < m_options.gestures.size(); ++gesture) {
+                const auto& rule = m_options.gestures[gesture];
+                auto code = std::find(rule.codes.begin(), rule.codes.end(), event.code);
+                if (rule.type == event.type && code != rule.codes.end())
+                    recognizeGesture(device, gesture, static_cast<size_t>(code - rule.codes.begin()), event);
+            }
+        }
+    }
+
+    /// @brief Advances the recognition state of a gesture with an input event of one of its codes
+    /// @param device The device the input event was read from
+    /// @param gesture The index of the gesture in InputEventOptions::gestures
+    /// @param code The index of the event code in InputEventGesture::codes
+    /// @param event The input event
+    void recognizeGesture(Device& device, size_t gesture, size_t code, const input_event& event)
+    {
+        const auto& rule = m_options.gestures[gesture];
+        auto& state = device.gestures[gesture];
+        int64_t time = eventTime(event);
+
+        switch (rule.kind) {
+        case InputEventGestureKind::LongPress:
+            if (event.value && !state.deadline) {
+                state.deadline = time + rule.time.count();
+                ++device.gesturesPending;
+
+                // Replayed devices only recognize long presses based on the recorded timestamps
+                if (device.descriptor >= 0)
+                    armTimer(deviceTimer(device), state.deadline);
+            } else if (!event.value && state.deadline) {
+                state.deadline = 0;
+                --device.gesturesPending;
+            }
+            break;
+        case InputEventGestureKind::DoublePress:
+            if (!event.value)
+                break;
+
+            if (state.pressed && time - state.time <= rule.time.count()) {
+                state.pressed = false;
+                device.gestureEvents.push_back(gestureEvent(time, gesture));
+            } else {
+                state.pressed = true;
+                state.time = time;
+            }
+            break;
+        case InputEventGestureKind::Chord: {
+            if (code >= 64)
+                break;
+
+            uint64_t bit = uint64_t(1) << code;
+            if (!event.value) {
+                state.held &= ~bit;
+                state.recognized = false;
+                break;
+            }
+
+            if (!state.held)
+                state.time = time;
+            state.held |= bit;
+
+            uint64_t all = rule.codes.size() >= 64 ? UINT64_MAX : (uint64_t(1) << rule.codes.size()) - 1;
+            if (state.held == all && !state.recognized && time - state.time <= rule.time.count()) {
+                state.recognized = true;
+                device.gestureEvents.push_back(gestureEvent(time, gesture));
+            }
+            break;
+        }
+        }
+    }
+
+    /// @brief Recognizes the long presses of a device held until a time
+    /// @param device The device with held long presses
+    /// @param time The kernel timestamp in microseconds to recognize the long presses until
+    void expireGestures(Device& device, int64_t time)
+    {
+        for (size_t gesture = 0; gesture < device.gestures.size(); ++gesture) {
+            auto& state = device.gestures[gesture];
+            if (!state.deadline || state.deadline > time)
+                continue;
+
+            device.gestureEvents.push_back(gestureEvent(state.deadline, gesture));
+            state.deadline = 0;
+            --device.gesturesPending;
+        }
+
+        if (!device.gestureEvents.empty())
+            dispatchGestures(device);
+    }
+
+    /// @brief Creates the input event of a recognized gesture
+    /// @param time The kernel timestamp of the input event in microseconds
+    /// @param gesture The index of the gesture in InputEventOptions::gestures
+    /// @return An input_event of InputEventGestureType
+    static input_event gestureEvent(int64_t time, size_t gesture)
+    {
+        input_event event {};
+        event.input_event_sec = time / 1000000;
+        event.input_event_usec = time % 1000000;
+        event.type = InputEventGestureType;
+        event.code = static_cast<uint16_t>(gesture);
+        event.value = 1;
+        return event;
+    }
+
+    /// @brief Dispatches the input events of the recognized gestures followed by a SYN_REPORT event
+    /// @param device The device the gestures were recognized for
+    void dispatchGestures(Device& device)
+    {
+        std::sort(device.gestureEvents.begin(), device.gestureEvents.end(), [](const auto& first, const auto& second) { return eventTime(first) < eventTime(second); });
+        input_event report = device.gestureEvents.back();
+        report.type = EV_SYN;
+        report.code = SYN_REPORT;
+        report.value = 0;
+        device.gestureEvents.push_back(report);
+
+        // The events are swapped out as the dispatch recognizes gestures again (without any input events of a gesture)
+        std::vector<input_event> events;
+        events.swap(device.gestureEvents);
+        dispatch(device, events.data(), events.size(), true);
+        events.clear();
+        device.gestureEvents.swap(events);
+    }
+
+    /// @brief Get the timer of the thread reading a device
+    /// @param device The device
+    /// @return A reference to the Timer of the worker thread or of the reader thread of the device
+    Timer& deviceTimer(const Device& device)
+    {
+        return device.reader ? device.reader->timer : m_timer;
+    }
+
+    /// @brief Arms a timer unless it expires before a deadline
+    /// @param timer The Timer to arm
+    /// @param deadline The time in microseconds to expire at (using the clock of the input devices)
+    static void armTimer(Timer& timer, int64_t deadline)
+    {
+        if (timer.descriptor < 0 || (timer.deadline && timer.deadline <= deadline))
+            return;
+
+        itimerspec expiration {};
+        expiration.it_value.tv_sec = deadline / 1000000;
+        expiration.it_value.tv_nsec = (deadline % 1000000) * 1000;
+        if (expiration.it_value.tv_sec == 0 && expiration.it_value.tv_nsec == 0)
+            expiration.it_value.tv_nsec = 1;
+
+        if (timerfd_settime(timer.descriptor, TFD_TIMER_ABSTIME, &expiration, nullptr) == 0)
+            timer.deadline = deadline;
+    }
+
+    /// @brief Delivers the expired held back values and long presses of the devices of a thread when its timer expires
+    /// @param timer The expired Timer
+    /// @param devices The devices read by the thread (indexed by descriptor)
+    void handleTimer(Timer& timer, const std::vector<Device*>& devices)
+    {
+        uint64_t expirations;
+        [[maybe_unused]] auto result = read(timer.descriptor, &expirations, sizeof(expirations));
+        timer.deadline = 0;
+
+        timespec now {};
+        clock_gettime(m_options.clockId, &now);
+        int64_t time = static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+
+        for (auto device : devices) {
+            if (device && device->debouncePending)
+                releaseDebounced(*device, time);
+            if (device && device->gesturesPending)
+                expireGestures(*device, time);
+        }
+
+        // The timer is armed again for the earliest deadline left
+        for (auto device : devices) {
+            if (!device)
+                continue;
+
+            for (const auto& entry : device->debounce) {
+                if (entry.second.pending)
+                    armTimer(timer, entry.second.deadline);
+            }
+
+            for (const auto& gesture : device->gestures) {
+                if (gesture.deadline)
+                    armTimer(timer, gesture.deadline);
+            }
+        }
+    }
+
+    /// @brief Records input events read from a device, adding the device to the recording first if needed
+    /// @param device The device the input events were read from
+    /// @param events A pointer to the input events read
+    /// @param count The number of input events read
+    void recordEvents(Device& device, const input_event* events, size_t count)
+    {
+        if (device.recording != m_recording) {
+            device.recording = m_recording;
+            device.recordIndex = m_recorder->addDevice(device.info);
+        }
+
+        if (device.recordIndex >= 0)
+            m_recorder->record(device.recordIndex, events, count);
+    }
+
+    /// @brief Updates the statistics with a batch of input events read from a device
+    /// @param events A pointer to the input events read
+    /// @param count The number of input events read
+    void updateStats(const input_event* events, size_t count)
+    {
+        // The latency is measured against a single timestamp per batch using the clock of the input devices
+        timespec time {};
+        clock_gettime(m_options.clockId, &time);
+        int64_t now = static_cast<int64_t>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+
+        uint64_t dropped = 0;
+        uint64_t filtered = 0;
+        for (size_t index = 0; index < count; ++index) {
+            const auto& event = events[index];
+            dropped += event.type == EV_SYN && event.code == SYN_DROPPED;
+            filtered += !m_monitorFilter.matches(event);
+
+            int64_t latency = now - (static_cast<int64_t>(event.input_event_sec) * 1000000 + event.input_event_usec);
+            size_t bucket = latency > 0 ? 64 - __builtin_clzll(latency) : 0;
+            m_stats.latency[std::min(bucket, InputEventLatencyBuckets - 1)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        m_stats.events.fetch_add(count, std::memory_order_relaxed);
+        m_stats.batches.fetch_add(1, std::memory_order_relaxed);
+        m_stats.dropped.fetch_add(dropped, std::memory_order_relaxed);
+        m_stats.filtered.fetch_add(filtered, std::memory_order_relaxed);
+    }
+
+    /// @brief Updates the cached state of a device from input events and replaces the input events lost after a
+    /// SYN_DROPPED event with events synthesized from the current state of the device
+    /// @param device The device the input events were read from
+    /// @param events A pointer to the input events read
+    /// @param count The number of input events read (updated to the number of input events to dispatch)
+    /// @return A pointer to the input events to dispatch
+    input_event* resynchronizeEvents(Device& device, input_event* events, size_t& count)
+    {
+        // Dispatch the input events in place unless some of them have to be discarded or synthesized
+        size_t index = 0;
+        if (!device.dropped) {
+            for (; index < count; ++index) {
+                if (events[index].type == EV_SYN && events[index].code == SYN_DROPPED)
+                    break;
+
+                updateState(device, events[index]);
+            }
+
+            if (index == count)
+                return events;
+        }
+
+        device.resyncEvents.assign(events, events + index);
+        for (; index < count; ++index) {
+            auto& event = events[index];
+
+            // After SYN_DROPPED all events up to and including the next SYN_REPORT are incomplete and discarded.
+            // The state changes missed are synthesized from the current state of the device instead.
+            if (device.dropped) {
+                if (event.type == EV_SYN && event.code == SYN_REPORT) {
+                    device.dropped = false;
+                    resynchronize(device, event.time);
+                }
+                continue;
+            }
+
+            if (event.type == EV_SYN && event.code == SYN_DROPPED)
+                device.dropped = true;
+
+            updateState(device, event);
+            device.resyncEvents.push_back(event);
+        }
+
+        count = device.resyncEvents.size();
+        return device.resyncEvents.data();
+    }
+
+    /// @brief Accumulates an input event in the frame of a device and dispatches the frame when it is complete
+    /// @param device The device the input event was read from
+    /// @param event The input event to accumulate
+    /// @param subscriptions The subscriptions to dispatch the frame to
+    void assembleFrame(Device& device, const input_event& event, const SubscriptionList& subscriptions)
+    {
+        if (event.type == EV_SYN && event.code == SYN_DROPPED) {
+            device.frame.clear();
+            return;
+        }
+
+        bool report = event.type == EV_SYN && event.code == SYN_REPORT;
+        if (device.frameOversized) {
+            device.frameOversized = !report;
+            return;
+        }
+
+        if (device.frame.size() == InputEventMaxFrameSize) {
+            device.frame.clear();
+            device.frameOversized = !report;
+            if (m_options.collectStats)
+                m_stats.oversizedFrames.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        device.frame.push_back(event);
+        if (report) {
+            dispatchFrame(device, subscriptions);
+            device.frame.clear();
+        }
+    }
+
+    /// @brief Updates the cached state of a device from an input event
+    /// @param device The device the input event was read from
+    /// @param event The input event changing the state
+    static void updateState(Device& device, const input_event& event)
+    {
+        if (event.type == EV_ABS) {
+            if (event.code < ABS_CNT)
+                device.absValues[event.code].store(event.value, std::memory_order_relaxed);
+            return;
+        }
+
+        int index = stateIndex(event.type);
+        if (index < 0 || event.code >= StateCodes[index])
+            return;
+
+        // Only the worker thread writes the state so a plain load and store is sufficient
+        auto& word = device.state[index][event.code / 64];
+        uint64_t bit = uint64_t(1) << (event.code % 64);
+        uint64_t bits = word.load(std::memory_order_relaxed);
+        word.store(event.value ? (bits | bit) : (bits & ~bit), std::memory_order_relaxed);
+    }
+
+    /// @brief Seeds the cached state of a device with its current state
+    /// @param device The device to initialize
+    void initializeState(Device& device)
+    {
+        for (size_t index = 0; index < StateTypes.size(); ++index) {
+            StateBits bits {};
+            queryState(device.descriptor, StateTypes[index], bits.data(), sizeof(bits));
+            storeState(device, index, bits);
+        }
+
+        if (!m_options.cacheState)
+            return;
+
+        std::array<uint64_t, (ABS_CNT + 63) / 64> absBits {};
+        if (ioctl(device.descriptor, EVIOCGBIT(EV_ABS, sizeof(absBits)), absBits.data()) < 0)
+            return;
+
+        for (uint16_t code = 0; code < ABS_CNT; ++code) {
+            input_absinfo absInfo;
+            if (((absBits[code / 64] >> (code % 64)) & 1) && ioctl(device.descriptor, EVIOCGABS(code), &absInfo) == 0) {
+                device.absAxes.set(code);
+                device.absValues[code].store(absInfo.value, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief Stores the state of an event type of a device
+    /// @param device The device to store the state of
+    /// @param index The index of the event type in StateTypes
+    /// @param bits The state to store
+    static void storeState(Device& device, size_t index, const StateBits& bits)
+    {
+        for (size_t word = 0; word < bits.size(); ++word)
+            device.state[index][word].store(bits[word], std::memory_order_relaxed);
+    }
+
+    /// @brief Get the current state of an event type of a device
+    /// @param device The device to get the state of
+    /// @param eventType One of EV_KEY, EV_SW, EV_LED or EV_SND
+    /// @param[out] bits A reference to a StateBits object to store the state
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int deviceState(const Device& device, uint16_t eventType, StateBits& bits)
+    {
+        int index = stateIndex(eventType);
+        if (index < 0)
+            return -ENOTSUP;
+
+        if (m_options.cacheState) {
+            for (size_t word = 0; word < bits.size(); ++word)
+                bits[word] = device.state[index][word].load(std::memory_order_relaxed);
+            return 0;
+        }
+
+        bits = {};
+        return queryState(device.descriptor, eventType, bits.data(), sizeof(bits)) < 0 ? -errno : 0;
+    }
+
+    /// @brief Converts a state bitmap to an InputEventBits object
+    /// @param bits The state bitmap to convert
+    /// @param[out] eventBits A reference to an InputEventBits object to store the state
+    static void toEventBits(const StateBits& bits, InputEventBits& eventBits)
+    {
+        eventBits.reset();
+
+        for (size_t word = 0; word < bits.size(); ++word) {
+            for (uint64_t set = bits[word]; set; set &= set - 1)
+                eventBits.set(word * 64 + __builtin_ctzll(set));
+        }
+    }
+
+    /// @brief Get the cached input event value for the specified event type and code
+    /// @param eventType An event type from <linux/input-event-codes.h>
+    /// @param eventCode An event code from <linux/input-event-codes.h>
+    /// @return An int with the result (see value)
+    int cachedValue(uint16_t eventType, uint16_t eventCode)
+    {
+        // The published devices are read without the device lock, so value is never blocked by opening or closing devices
+        auto devices = std::atomic_load(&m_cachedDevices);
+        if (devices->empty())
+            return -EBADF;
+
+        if (eventType == EV_ABS) {
+            if (eventCode >= ABS_CNT)
+                return -EINVAL;
+
+            for (const auto& device : *devices) {
+                if (device->absAxes[eventCode])
+                    return device->absValues[eventCode].load(std::memory_order_relaxed);
+            }
+
+            return -ENOTSUP;
+        }
+
+        int index = stateIndex(eventType);
+        if (index < 0)
+            return -ENOTSUP;
+
+        if (eventCode >= StateCodes[index])
+            return -EINVAL;
+
+        uint64_t bits = 0;
+        for (const auto& device : *devices)
+            bits |= device->state[index][eventCode / 64].load(std::memory_order_relaxed);
+
+        return (bits >> (eventCode % 64)) & 1;
+    }
+
+    /// @brief Queries the current state of a device and appends the differences to the cached state as input events
+    /// followed by a SYN_REPORT event to the input events to dispatch
+    /// @param device The device to resynchronize
+    /// @param time The timestamp to use for the synthesized input events
+    void resynchronize(Device& device, const timeval& time)
+    {
+        bool changed = false;
+
+        for (size_t index = 0; index < StateTypes.size(); ++index) {
+            StateBits bits {};
+            if (queryState(device.descriptor, StateTypes[index], bits.data(), sizeof(bits)) < 0)
+                continue;
+
+            for (size_t word = 0; word < bits.size(); ++word) {
+                uint64_t changes = bits[word] ^ device.state[index][word].load(std::memory_order_relaxed);
+                for (; changes; changes &= changes - 1) {
+                    int bit = __builtin_ctzll(changes);
+                    device.resyncEvents.push_back({ time, StateTypes[index], static_cast<uint16_t>(word * 64 + bit), static_cast<int32_t>((bits[word] >> bit) & 1) });
+                    changed = true;
+                }
+            }
+
+            storeState(device, index, bits);
+        }
+
+        if (changed)
+            device.resyncEvents.push_back({ time, EV_SYN, SYN_REPORT, 0 });
+    }
+
+    /// @brief Dispatches an error event to the callbacks of all subscriptions
+    /// @param event The error event to dispatch
+    void dispatchError(input_event& event)
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_subscriptionMutex);
+        auto subscriptions = m_subscriptions;
+        lock.unlock();
+
+        for (const auto& subscription : *subscriptions) {
+            auto& entry = *subscription;
+            auto entryLock = lockSubscription(entry);
+            if (!entry.removed)
+                entry.dispatchError(NoDevice, event);
+        }
+    }
+
+    /// @brief Dispatches a complete frame to the frame subscriptions with matching events in the frame
+    /// @param device The device with the frame terminated by a SYN_REPORT event
+    /// @param subscriptions The subscriptions to dispatch the frame to
+    void dispatchFrame(Device& device, const SubscriptionList& subscriptions)
+    {
+        for (const auto& subscription : subscriptions) {
+            auto& entry = *subscription;
+            if (!entry.frames)
+                continue;
+
+            auto entryLock = lockSubscription(entry);
+            if (!entry.removed)
+                entry.dispatchFrame(device.info, device.frame, device.frameEvents);
+        }
+    }
+
+    /// @brief Registers a descriptor with the wait mechanism of the configured backend
+    /// @param descriptor The descriptor to register
+    /// @return A bool which is true if the descriptor could be registered
+    bool registerDescriptor(int descriptor)
+    {
+        if (m_backend == InputEventBackend::IoUring)
+            return registerRingDescriptor(descriptor);
+
+        if (m_backend == InputEventBackend::Epoll) {
+            if (m_epollDescriptor < 0)
+                return false;
+
+            epoll_event epollEvent {};
+            epollEvent.events = EPOLLIN;
+            epollEvent.data.fd = descriptor;
+            return epoll_ctl(m_epollDescriptor, EPOLL_CTL_ADD, descriptor, &epollEvent) == 0;
+        }
+
+        m_pollDescriptors.push_back({ descriptor, POLLIN, 0 });
+        return true;
+    }
+
+    /// @brief Unregisters a descriptor from the wait mechanism of the configured backend
+    /// @param descriptor The descriptor to unregister
+    void unregisterDescriptor(int descriptor)
+    {
+        if (m_backend == InputEventBackend::IoUring)
+            unregisterRingDescriptor(descriptor);
+        else if (m_backend == InputEventBackend::Epoll)
+            epoll_ctl(m_epollDescriptor, EPOLL_CTL_DEL, descriptor, nullptr);
+        else
+            m_pollDescriptors.erase(std::remove_if(m_pollDescriptors.begin(), m_pollDescriptors.end(), [descriptor](const auto& pollDescriptor) { return pollDescriptor.fd == descriptor; }), m_pollDescriptors.end());
+    }
+
+    /// @brief Wakes up the worker thread if it is waiting for input events
+    void wakeup()
+    {
+        if (m_wakeupDescriptor >= 0) {
+            uint64_t value = 1;
+            [[maybe_unused]] auto result = write(m_wakeupDescriptor, &value, sizeof(value));
+        }
+    }
+
+    /// @brief Clears a pending wakeup of the worker thread
+    void clearWakeup()
+    {
+        uint64_t value;
+        [[maybe_unused]] auto result = read(m_wakeupDescriptor, &value, sizeof(value));
+    }
+
+    /// @brief Waits for input events using the configured backend
+    /// @param[out] readyDescriptors A reference to an InputEventDescriptors object to store the ready descriptors
+    /// @param timeout The maximum time to wait in milliseconds (or -1 to wait indefinitely)
+    /// @return An int with the result of the wait (see poll.h and sys/epoll.h)
+    int waitForInputEvent(InputEventDescriptors& readyDescriptors, int timeout)
+    {
+        if (m_backend == InputEventBackend::Epoll)
+            return epollForInputEvent(readyDescriptors, timeout);
+
+        return pollForInputEvent(readyDescriptors, timeout);
+    }
+
+    /// @brief Polls for input events on the registered descriptors
+    /// @param[out] readyDescriptors A reference to an InputEventDescriptors object to store the ready descriptors
+    /// @param timeout The maximum time to wait in milliseconds (or -1 to wait indefinitely)
+    /// @return An int with the result of the poll (see poll.h)
+    int pollForInputEvent(InputEventDescriptors& readyDescriptors, int timeout)
+    {
+        int result = poll(m_pollDescriptors.data(), m_pollDescriptors.size(), timeout);
+        if (result > 0) {
+            for (const auto& pollDescriptor : m_pollDescriptors) {
+                if (!pollDescriptor.revents)
+                    continue;
+
+                if (pollDescriptor.fd == m_wakeupDescriptor)
+                    clearWakeup();
+                else
+                    readyDescriptors.push_back(pollDescriptor.fd);
+            }
+        }
+
+        return result;
+    }
+
+    /// @brief Waits for input events on the epoll instance with the registered descriptors
+    /// @param[out] readyDescriptors A reference to an InputEventDescriptors object to store the ready descriptors
+    /// @param timeout The maximum time to wait in milliseconds (or -1 to wait indefinitely)
+    /// @return An int with the result of the wait (see sys/epoll.h)
+    int epollForInputEvent(InputEventDescriptors& readyDescriptors, int timeout)
+    {
+        std::array<epoll_event, MaxReadyDescriptors> epollEvents;
+
+        int result = epoll_wait(m_epollDescriptor, epollEvents.data(), epollEvents.size(), timeout);
+        for (int index = 0; index < result; ++index) {
+            if (epollEvents[index].data.fd == m_wakeupDescriptor)
+                clearWakeup();
+            else
+                readyDescriptors.push_back(epollEvents[index].data.fd);
+        }
+
+        return result;
+    }
+
+    /// @brief The counters behind InputEventStats
+    struct StatsCounters {
+        std::atomic<uint64_t> events { 0 };
+        std::atomic<uint64_t> batches { 0 };
+        std::atomic<uint64_t> filtered { 0 };
+        std::atomic<uint64_t> deliveries { 0 };
+        std::atomic<uint64_t> dropped { 0 };
+        std::atomic<uint64_t> debounced { 0 };
+        std::atomic<uint64_t> oversizedFrames { 0 };
+        std::atomic<uint64_t> callbackTime { 0 };
+        std::atomic<uint64_t> maxCallbackTime { 0 };
+        std::array<std::atomic<uint64_t>, InputEventLatencyBuckets> latency {};
+    };
+
+    /// @brief The mapped submission and completion queues of an io_uring instance
+    struct Ring {
+        int descriptor = -1;
+        void* submissionMap = MAP_FAILED;
+        size_t submissionMapSize = 0;
+        void* completionMap = MAP_FAILED;
+        size_t completionMapSize = 0;
+        io_uring_sqe* entries = static_cast<io_uring_sqe*>(MAP_FAILED);
+        size_t entriesSize = 0;
+        unsigned* submissionHead = nullptr;
+        unsigned* submissionTail = nullptr;
+        unsigned* submissionArray = nullptr;
+        unsigned submissionMask = 0;
+        unsigned submissionEntries = 0;
+        unsigned* completionHead = nullptr;
+        unsigned* completionTail = nullptr;
+        io_uring_cqe* completions = nullptr;
+        unsigned completionMask = 0;
+        unsigned pending = 0;
+        /// The expiry of the queued IORING_OP_TIMEOUT entry, which is read by the kernel when it is submitted
+        __kernel_timespec timeout {};
+        bool timeoutQueued = false;
+    };
+
+    /// @brief A descriptor registered with the io_uring instance and the buffer of the read posted for it
+    struct RingSlot {
+        int descriptor = -1;
+        bool read = false;
+        bool polling = false;
+        bool pending = false;
+        std::array<input_event, InputEventBatchSize> buffer;
+    };
+
+    /// The input device passed to the callbacks with error events
+    inline static const InputEventDeviceInfo NoDevice {};
+
+    /// The number of submission queue entries of the io_uring instance
+    static constexpr unsigned RingEntries = 256;
+    /// The user data of completions which are not related to a ring slot
+    static constexpr uint64_t RingIgnoredData = UINT64_MAX;
+
+    /// @brief Creates the io_uring instance and maps its queues
+    /// @return A bool which is true if io_uring is available
+    bool setupRing()
+    {
+        io_uring_params params {};
+        m_ring.descriptor = syscall(__NR_io_uring_setup, RingEntries, &params);
+        if (m_ring.descriptor < 0)
+            return false;
+
+        m_ring.submissionMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_ring.completionMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            m_ring.submissionMapSize = m_ring.completionMapSize = std::max(m_ring.submissionMapSize, m_ring.completionMapSize);
+
+        m_ring.submissionMap = mmap(nullptr, m_ring.submissionMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring.descriptor, IORING_OFF_SQ_RING);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            m_ring.completionMap = m_ring.submissionMap;
+        else
+            m_ring.completionMap = mmap(nullptr, m_ring.completionMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring.descriptor, IORING_OFF_CQ_RING);
+
+        m_ring.entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+        m_ring.entries = static_cast<io_uring_sqe*>(mmap(nullptr, m_ring.entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring.descriptor, IORING_OFF_SQES));
+
+        if (m_ring.submissionMap == MAP_FAILED || m_ring.completionMap == MAP_FAILED || m_ring.entries == MAP_FAILED) {
+            closeRing();
+            return false;
+        }
+
+        auto submission = static_cast<char*>(m_ring.submissionMap);
+        m_ring.submissionHead = reinterpret_cast<unsigned*>(submission + params.sq_off.head);
+        m_ring.submissionTail = reinterpret_cast<unsigned*>(submission + params.sq_off.tail);
+        m_ring.submissionArray = reinterpret_cast<unsigned*>(submission + params.sq_off.array);
+        m_ring.submissionMask = *reinterpret_cast<unsigned*>(submission + params.sq_off.ring_mask);
+        m_ring.submissionEntries = params.sq_entries;
+
+        auto completion = static_cast<char*>(m_ring.completionMap);
+        m_ring.completionHead = reinterpret_cast<unsigned*>(completion + params.cq_off.head);
+        m_ring.completionTail = reinterpret_cast<unsigned*>(completion + params.cq_off.tail);
+        m_ring.completions = reinterpret_cast<io_uring_cqe*>(completion + params.cq_off.cqes);
+        m_ring.completionMask = *reinterpret_cast<unsigned*>(completion + params.cq_off.ring_mask);
+
+        m_ringCompletions.reserve(params.cq_entries);
+        return true;
+    }
+
+    /// @brief Unmaps the queues and closes the io_uring instance
+    void closeRing()
+    {
+        if (m_ring.entries != MAP_FAILED)
+            munmap(m_ring.entries, m_ring.entriesSize);
+
+        if (m_ring.completionMap != MAP_FAILED && m_ring.completionMap != m_ring.submissionMap)
+            munmap(m_ring.completionMap, m_ring.completionMapSize);
+
+        if (m_ring.submissionMap != MAP_FAILED)
+            munmap(m_ring.submissionMap, m_ring.submissionMapSize);
+
+        if (m_ring.descriptor >= 0)
+            close(m_ring.descriptor);
+
+        m_ring = Ring();
+    }
+
+    /// @brief Queues a submission queue entry (submitting the queued entries first if the queue is full)
+    /// @param entry The submission queue entry to queue
+    /// @return A bool which is true if the entry was queued
+    bool queueRingEntry(const io_uring_sqe& entry)
+    {
+        unsigned tail = *m_ring.submissionTail;
+        if (tail - __atomic_load_n(m_ring.submissionHead, __ATOMIC_ACQUIRE) == m_ring.submissionEntries && submitRing() <= 0)
+            return false;
+
+        unsigned index = tail & m_ring.submissionMask;
+        m_ring.entries[index] = entry;
+        m_ring.submissionArray[index] = index;
+        __atomic_store_n(m_ring.submissionTail, tail + 1, __ATOMIC_RELEASE);
+        ++m_ring.pending;
+        return true;
+    }
+
+    /// @brief Submits the queued submission queue entries
+    /// @return An int with the result (the number of submitted entries on success or a negative value from errno.h)
+    int submitRing()
+    {
+        int result = syscall(__NR_io_uring_enter, m_ring.descriptor, m_ring.pending, 0, 0, nullptr, 0);
+        if (result < 0)
+            return -errno;
+
+        m_ring.pending -= result;
+        return result;
+    }
+
+    /// @brief Posts a read (or a poll for readiness) for a ring slot
+    /// @param slot The index of the ring slot
+    /// @return A bool which is true if the operation was queued
+    bool postRingSlot(size_t slot)
+    {
+        auto& entry = *m_ringSlots[slot];
+        io_uring_sqe sqe {};
+        sqe.fd = entry.descriptor;
+        sqe.user_data = slot;
+
+        if (entry.read && !entry.polling) {
+            sqe.opcode = IORING_OP_READ;
+            sqe.addr = reinterpret_cast<uintptr_t>(entry.buffer.data());
+            sqe.len = sizeof(entry.buffer);
+            sqe.off = static_cast<uint64_t>(-1);
+        } else {
+            sqe.opcode = IORING_OP_POLL_ADD;
+            sqe.poll32_events = POLLIN;
+        }
+
+        return entry.pending = queueRingEntry(sqe);
+    }
+
+    /// @brief Registers a descriptor with the io_uring instance
+    /// Input devices get a read posted while the wakeup and inotify descriptors get a poll for readiness posted.
+    /// @param descriptor The descriptor to register
+    /// @return A bool which is true if the descriptor could be registered
+    bool registerRingDescriptor(int descriptor)
+    {
+        // Slots are only reused once the operation posted for them has completed, as the kernel may still write to
+        // the buffer until then
+        auto slot = std::find_if(m_ringSlots.begin(), m_ringSlots.end(), [](const auto& entry) { return entry->descriptor < 0 && !entry->pending; });
+        if (slot == m_ringSlots.end())
+            slot = m_ringSlots.insert(slot, std::make_unique<RingSlot>());
+
+        auto& entry = **slot;
+        entry.descriptor = descriptor;
+        entry.read = descriptor != m_wakeupDescriptor && descriptor != m_inotifyDescriptor && descriptor != m_timer.descriptor;
+        entry.polling = false;
+
+        if (!postRingSlot(slot - m_ringSlots.begin())) {
+            entry.descriptor = -1;
+            return false;
+        }
+
+        return true;
+    }
+
+    /// @brief Unregisters a descriptor from the io_uring instance by cancelling the operation posted for it
+    /// @param descriptor The descriptor to unregister
+    void unregisterRingDescriptor(int descriptor)
+    {
+        for (size_t slot = 0; slot < m_ringSlots.size(); ++slot) {
+            auto& entry = *m_ringSlots[slot];
+            if (entry.descriptor != descriptor)
+                continue;
+
+            entry.descriptor = -1;
+            if (entry.pending) {
+                io_uring_sqe sqe {};
+                sqe.opcode = IORING_OP_ASYNC_CANCEL;
+                sqe.addr = slot;
+                sqe.user_data = RingIgnoredData;
+                queueRingEntry(sqe);
+            }
+        }
+
+        // The queued operations are submitted before the descriptor is closed (and possibly reused)
+        submitRing();
+    }
+
+    /// @brief Submits the posted operations, waits for completions and dispatches the input events read
+    /// @param timeout The maximum time to wait in milliseconds (0 to return immediately or -1 to wait indefinitely)
+    /// @return An int with the result (the number of input events read on success or a negative value from errno.h)
+    int processRingEvents(int timeout)
+    {
+        // The timeout completes after the first other completion or when it expires. The entry may stay queued when
+        // io_uring_enter does not submit it (e.g. with EBUSY on a completion queue overflow), so the timespec is kept
+        // with the ring and no further timeout is queued until it has been submitted.
+        if (timeout > 0 && !m_ring.timeoutQueued) {
+            m_ring.timeout = { timeout / 1000, (timeout % 1000) * 1000000LL };
+            io_uring_sqe sqe {};
+            sqe.opcode = IORING_OP_TIMEOUT;
+            sqe.addr = reinterpret_cast<uintptr_t>(&m_ring.timeout);
+            sqe.len = 1;
+            sqe.off = 1;
+            sqe.user_data = RingIgnoredData;
+            queueRingEntry(sqe);
+            m_ring.timeoutQueued = true;
+        }
+
+        // An interrupted wait is handled like a timeout, the completions posted so far are still handled
+        unsigned wait = timeout ? 1 : 0;
+        int result = syscall(__NR_io_uring_enter, m_ring.descriptor, m_ring.pending, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (result < 0 && errno != EBUSY && errno != EINTR)
+            return -errno;
+
+        // The entries are submitted in order, so the timeout has been submitted once no entries are pending
+        m_ring.pending -= result > 0 ? result : 0;
+        if (!m_ring.pending)
+            m_ring.timeoutQueued = false;
+
+        // The completions are copied first as handling them may submit new entries
+        unsigned head = *m_ring.completionHead;
+        unsigned tail = __atomic_load_n(m_ring.completionTail, __ATOMIC_ACQUIRE);
+        m_ringCompletions.clear();
+        for (; head != tail; ++head)
+            m_ringCompletions.push_back(m_ring.completions[head & m_ring.completionMask]);
+        __atomic_store_n(m_ring.completionHead, head, __ATOMIC_RELEASE);
+
+        int count = 0;
+        int error = 0;
+        bool hotPlug = false;
+        bool debounce = false;
+
+        for (const auto& completion : m_ringCompletions) {
+            if (completion.user_data == RingIgnoredData)
+                continue;
+
+            auto& entry = *m_ringSlots[completion.user_data];
+            entry.pending = false;
+            if (entry.descriptor < 0)
+                continue;
+
+            if (!entry.read) {
+                if (entry.descriptor == m_wakeupDescriptor)
+                    clearWakeup();
+                else if (entry.descriptor == m_timer.descriptor)
+                    debounce = true;
+                else
+                    hotPlug = true;
+            } else if (entry.polling)
+                entry.polling = false;
+            else if (completion.res > 0) {
+                auto device = m_descriptorDevices[entry.descriptor];
+                count += completion.res / sizeof(input_event);
+                dispatch(*device, entry.buffer.data(), completion.res / sizeof(input_event));
+            } else if (completion.res == -EAGAIN)
+                entry.polling = true;
+            // Reads posted by a previous worker thread are cancelled when it exits and are posted again
+            else if (completion.res < 0 && completion.res != -EINTR && completion.res != -ECANCELED) {
+                // A removed device is closed right away instead of waiting for the inotify event, while other
+                // errors also stop the worker thread as reading the device again would fail in the same way
+                closeDevice(*m_descriptorDevices[entry.descriptor]);
+                if (completion.res != -ENODEV)
+                    error = completion.res;
+                continue;
+            }
+
+            postRingSlot(completion.user_data);
+        }
+
+        if (debounce)
+            handleTimer(m_timer, m_descriptorDevices);
+
+        // The devices are updated after reading to not invalidate the devices with pending input events
+        if (hotPlug)
+            handleHotPlug();
+
+        return error ? error : count;
+    }
+
+    /// @brief Cancels the operations posted for the ring slots and waits for them to complete
+    /// The buffers of the ring slots may be written until the reads posted to them have completed. Slots with
+    /// operations which do not complete within a second are released without being freed.
+    void cancelRing()
+    {
+        for (size_t slot = 0; slot < m_ringSlots.size(); ++slot) {
+            m_ringSlots[slot]->descriptor = -1;
+            if (m_ringSlots[slot]->pending) {
+                io_uring_sqe sqe {};
+                sqe.opcode = IORING_OP_ASYNC_CANCEL;
+                sqe.addr = slot;
+                sqe.user_data = RingIgnoredData;
+                queueRingEntry(sqe);
+            }
+        }
+
+        auto pending = [this]() { return std::any_of(m_ringSlots.begin(), m_ringSlots.end(), [](const auto& entry) { return entry->pending; }); };
+        for (int retry = 0; retry < 10 && pending(); ++retry)
+            processRingEvents(100);
+
+        for (auto& entry : m_ringSlots) {
+            if (entry->pending)
+                entry.release();
+        }
+        m_ringSlots.clear();
+    }
+
+    const InputEventOptions m_options;
+    const std::string m_inputEventPrefix;
+    const uint8_t m_maxInputEvents;
+    const int m_openFlags;
+    InputEventBackend m_backend;
+    std::mutex m_threadMutex;
+    std::thread m_thread;
+    std::atomic<bool> m_stopThread { false };
+    std::recursive_mutex m_subscriptionMutex;
+    std::recursive_mutex m_callbackMutex;
+    std::shared_ptr<const SubscriptionList> m_subscriptions = std::make_shared<SubscriptionList>();
+    int m_nextSubscriptionId = 1;
+    std::atomic<size_t> m_frameSubscriptions { 0 };
+    std::mutex m_deviceMutex;
+    std::vector<std::shared_ptr<Device>> m_devices;
+    /// The open devices read by value with InputEventOptions::cacheState (replaced on every open and close)
+    std::shared_ptr<const std::vector<std::shared_ptr<Device>>> m_cachedDevices = std::make_shared<const std::vector<std::shared_ptr<Device>>>();
+    /// The index of the next opened device, which is also taken by replay from the calling thread
+    std::atomic<int> m_nextDeviceIndex { 0 };
+    std::vector<DeviceRequest> m_deviceRequests;
+    std::atomic<bool> m_deviceRequestsPending { false };
+    std::unordered_set<std::string> m_closedDevices;
+    std::vector<Device*> m_descriptorDevices;
+    std::vector<pollfd> m_pollDescriptors;
+    InputEventDescriptors m_readyDescriptors;
+    int m_epollDescriptor = -1;
+    int m_wakeupDescriptor = -1;
+    int m_inotifyDescriptor = -1;
+    Timer m_timer;
+    std::vector<std::unique_ptr<Reader>> m_readers;
+    size_t m_nextReader = 0;
+    int m_stopDescriptor = -1;
+    InputEventFilter m_gestureFilter;
+    Ring m_ring;
+    std::vector<std::unique_ptr<RingSlot>> m_ringSlots;
+    std::vector<io_uring_cqe> m_ringCompletions;
+    std::atomic<bool> m_updateDevices { false };
+    InputEventFilter m_monitorFilter;
+    InputEventRecorder* m_recorder = nullptr;
+    size_t m_recording = 0;
+    StatsCounters m_stats;
+    int m_waitTimeout = 1000;
+};
+
+/// @brief Writer of input events to a virtual input device created with uinput
+/// The virtual input device supports the specified event types and codes and can be read like any other input device
+/// (e.g. with InputEvent) at the path returned by devicePath. The device is destroyed with the writer.
+/// @code
+/// Linux::Input::InputEventWriter writer("virtual-remote", { EV_KEY }, { KEY_PLAY, KEY_PAUSE });
+/// writer.write(EV_KEY, KEY_PLAY, 1);
+/// @endcode
+class InputEventWriter {
+public:
+    /// @brief InputEventWriter constructor creating the virtual input device
+    /// @param name The name of the virtual input device
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @param uinputPath The path of the uinput device (default /dev/uinput)
+    InputEventWriter(const std::string& name, const InputEventList& eventTypes, const InputEventList& eventCodes, const std::string& uinputPath = "/dev/uinput")
+    {
+        m_descriptor = open(uinputPath.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (m_descriptor < 0)
+            return;
+
+        if (!enableEvents(eventTypes, eventCodes) || !createDevice(name)) {
+            close(m_descriptor);
+            m_descriptor = -1;
+        }
+    }
+
+    /// @brief InputEventWriter destructor destroying the virtual input device
+    ~InputEventWriter()
+    {
+        if (m_descriptor >= 0) {
+            ioctl(m_descriptor, UI_DEV_DESTROY);
+            close(m_descriptor);
+        }
+    }
+
+    InputEventWriter(const InputEventWriter&) = delete;
+    InputEventWriter& operator=(const InputEventWriter&) = delete;
+
+    /// @brief Get the uinput descriptor of the writer
+    /// @return An int with the descriptor (or a negative value if the virtual input device could not be created)
+    int descriptor() const
+    {
+        return m_descriptor;
+    }
+
+    /// @brief Get the path of the event device of the virtual input device (e.g. /dev/input/event5)
+    /// @note The device node is created asynchronously by devtmpfs or udev and may not exist yet
+    /// @return A std::string with the path (or empty if not available)
+    std::string devicePath() const
+    {
+        char name[64] {};
+        if (m_descriptor < 0 || ioctl(m_descriptor, UI_GET_SYSNAME(sizeof(name) - 1), name) < 0)
+            return "";
+
+        std::string path;
+        DIR* directoryStream = opendir(("/sys/devices/virtual/input/" + std::string(name)).c_str());
+        if (!directoryStream)
+            return path;
+
+        while (auto entry = readdir(directoryStream)) {
+            if (!std::strncmp(entry->d_name, "event", 5))
+                path = "/dev/input/" + std::string(entry->d_name);
+        }
+        closedir(directoryStream);
+
+        return path;
+    }
+
+    /// @brief Write input events to the virtual input device with a single write
+    /// The input events should end with a SYN_REPORT event to be delivered to readers as a complete frame. The kernel
+    /// sets the timestamps of the input events.
+    /// @param events A pointer to the input events to write
+    /// @param count The number of input events to write
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int write(const input_event* events, size_t count)
+    {
+        if (m_descriptor < 0)
+            return -EBADF;
+
+        ssize_t bytes = ::write(m_descriptor, events, count * sizeof(input_event));
+        if (bytes < 0)
+            return -errno;
+
+        return static_cast<size_t>(bytes) == count * sizeof(input_event) ? 0 : -EIO;
+    }
+
+    /// @brief Write a single input event followed by a SYN_REPORT event to the virtual input device
+    /// @param eventType An event type from <linux/input-event-codes.h>
+    /// @param eventCode An event code from <linux/input-event-codes.h>
+    /// @param eventValue The value of the input event
+    /// @return An int with the result (0 on success or or a negative value from errno.h)
+    int write(uint16_t eventType, uint16_t eventCode, int32_t eventValue)
+    {
+        std::array<input_event, 2> events {};
+        events[0].type = eventType;
+        events[0].code = eventCode;
+        events[0].value = eventValue;
+        events[1].type = EV_SYN;
+        events[1].code = SYN_REPORT;
+        return write(events.data(), events.size());
+    }
+
+private:
+    /// @brief The event types which can be enabled with the highest code and the ioctl enabling a code of each type
+    struct EventTypeBits {
+        uint16_t type;
+        uint16_t maxCode;
+        unsigned long request;
+    };
+
+    /// @brief Enables all combinations of the specified event types and codes for the virtual input device
+    /// @param eventTypes A std::vector with event types from <linux/input-event-codes.h>. Use UINT16_MAX for all types
+    /// @param eventCodes A std::vector with event codes from <linux/input-event-codes.h>. Use UINT16_MAX for all codes
+    /// @return A bool which is true if the event types and codes were enabled
+    bool enableEvents(const InputEventList& eventTypes, const InputEventList& eventCodes)
+    {
+        static const std::array<EventTypeBits, 8> typeBits { { { EV_KEY, KEY_MAX, UI_SET_KEYBIT }, { EV_REL, REL_MAX, UI_SET_RELBIT }, { EV_ABS, ABS_MAX, UI_SET_ABSBIT }, { EV_MSC, MSC_MAX, UI_SET_MSCBIT }, { EV_SW, SW_MAX, UI_SET_SWBIT }, { EV_LED, LED_MAX, UI_SET_LEDBIT }, { EV_SND, SND_MAX, UI_SET_SNDBIT }, { EV_FF, FF_MAX, UI_SET_FFBIT } } };
+
+        for (const auto& bits : typeBits) {
+            if (std::find_if(eventTypes.begin(), eventTypes.end(), [&bits](uint16_t type) { return type == bits.type || type == UINT16_MAX; }) == eventTypes.end())
+                continue;
+
+            if (ioctl(m_descriptor, UI_SET_EVBIT, bits.type) < 0)
+                return false;
+
+            for (const auto code : eventCodes) {
+                for (uint16_t eventCode = (code == UINT16_MAX ? 0 : code); eventCode <= bits.maxCode && (code == UINT16_MAX || eventCode == code); ++eventCode) {
+                    if (ioctl(m_descriptor, bits.request, eventCode) < 0)
+                        return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief Creates the virtual input device
+    /// @param name The name of the virtual input device
+    /// @return A bool which is true if the virtual input device was created
+    bool createDevice(const std::string& name)
+    {
+        uinput_setup setup {};
+        setup.id.bustype = BUS_VIRTUAL;
+        std::strncpy(setup.name, name.c_str(), UINPUT_MAX_NAME_SIZE - 1);
+
+        return ioctl(m_descriptor, UI_DEV_SETUP, &setup) == 0 && ioctl(m_descriptor, UI_DEV_CREATE) == 0;
+    }
+
+    int m_descriptor = -1;
 };
 
 } // namespace Linux::Input
@@ -0,0 +1,360 @@
+// Copyright (c) 2021 Bang & Olufsen a/s
+//
+// SPDX-License-Identifier: MIT
+
+#include <InputEvent.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+namespace {
+
+/// @brief The benchmark parameters given on the command line
+struct BenchmarkOptions {
+    size_t devices = 1;
+    size_t events = 100000;
+    size_t frameSize = 2;
+    size_t rate = 0;
+    bool uinput = false;
+    bool filter = false;
+    Linux::Input::InputEventOptions inputEventOptions;
+};
+
+/// @brief The measurements of a single reader thread made from within the callback
+struct ReaderThread {
+    timespec firstCpuTime {};
+    timespec lastCpuTime {};
+    long switches = -1;
+};
+
+/// @brief The measurements of all reader threads made from within the callback
+struct ReaderMeasurements {
+    std::mutex mutex;
+    std::vector<uint32_t> latencies;
+    std::atomic<size_t> received { 0 };
+    std::map<pid_t, ReaderThread> threads;
+};
+
+int64_t monotonicMicroseconds()
+{
+    timespec time {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+}
+
+double seconds(const timespec& time)
+{
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/// @brief Get the number of voluntary context switches of a thread (i.e. the number of times it blocked waiting)
+long contextSwitches(pid_t thread)
+{
+    std::ifstream status("/proc/self/task/" + std::to_string(thread) + "/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("voluntary_ctxt_switches:", 0) == 0)
+            return std::strtol(line.c_str() + line.find(':') + 1, nullptr, 10);
+    }
+
+    return 0;
+}
+
+/// @brief Writes frames of EV_KEY events followed by SYN_REPORT to a FIFO at the configured rate
+/// The keys are pressed and released in alternating frames, as uinput drops key events which do not change the state.
+void writeEvents(int descriptor, const BenchmarkOptions& options)
+{
+    std::vector<input_event> frame(options.frameSize + 1);
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t written = 0; written + options.frameSize <= options.events; written += options.frameSize) {
+        if (options.rate)
+            std::this_thread::sleep_until(start + std::chrono::microseconds(written * 1000000 / options.rate));
+
+        int64_t now = monotonicMicroseconds();
+        for (size_t index = 0; index < frame.size(); ++index) {
+            bool report = index == options.frameSize;
+            frame[index] = { { now / 1000000, now % 1000000 }, static_cast<uint16_t>(report ? EV_SYN : EV_KEY), static_cast<uint16_t>(report ? SYN_REPORT : KEY_A + index), static_cast<int32_t>((written / options.frameSize) & 1) };
+        }
+
+        if (write(descriptor, frame.data(), frame.size() * sizeof(input_event)) < 0) {
+            std::cerr << "Failed to write input events with error " << -errno << std::endl;
+            return;
+        }
+    }
+}
+
+bool parseOptions(int argc, char* argv[], BenchmarkOptions& options)
+{
+    for (int index = 1; index < argc; ++index) {
+        std::string argument = argv[index];
+        const char* value = index + 1 < argc ? argv[index + 1] : nullptr;
+
+        if (argument == "--batched")
+            options.inputEventOptions.batchedRead = true;
+        else if (argument == "--concurrent")
+            options.inputEventOptions.concurrentCallbacks = true;
+        else if (argument == "--uinput")
+            options.uinput = true;
+        else if (argument == "--filter")
+            options.filter = true;
+        else if (!value)
+            return false;
+        else if (argument == "--devices")
+            options.devices = std::strtoul(argv[++index], nullptr, 10);
+        else if (argument == "--events")
+            options.events = std::strtoul(argv[++index], nullptr, 10);
+        else if (argument == "--frame")
+            options.frameSize = std::strtoul(argv[++index], nullptr, 10);
+        else if (argument == "--rate")
+            options.rate = std::strtoul(argv[++index], nullptr, 10);
+        else if (argument == "--threads")
+            options.inputEventOptions.readerThreads = std::strtoul(argv[++index], nullptr, 10);
+        else if (argument == "--backend") {
+            std::string backend = argv[++index];
+            if (backend == "poll")
+                options.inputEventOptions.backend = Linux::Input::InputEventBackend::Poll;
+            else if (backend == "epoll")
+                options.inputEventOptions.backend = Linux::Input::InputEventBackend::Epoll;
+            else if (backend == "io_uring")
+                options.inputEventOptions.backend = Linux::Input::InputEventBackend::IoUring;
+            else
+                return false;
+        } else
+            return false;
+    }
+
+    return options.devices > 0 && options.devices <= UINT8_MAX && options.frameSize > 0 && options.events >= options.frameSize;
+}
+
+/// @brief Removes the input devices of the benchmark directory and the directory itself
+void removeDevices(const char* directory, const std::string& prefix, const std::vector<int>& descriptors, bool uinput)
+{
+    for (size_t device = 0; device < descriptors.size(); ++device) {
+        if (!uinput)
+            close(descriptors[device]);
+        std::remove((prefix + std::to_string(device)).c_str());
+    }
+    rmdir(directory);
+}
+
+/// @brief Measures the selection of the matching input events of read batches with each filter implementation
+/// The input events are a synthetic mix of a mouse and a keyboard: relative motion, key presses, scan codes and reports.
+void benchmarkFilters(const BenchmarkOptions& options)
+{
+    using Linux::Input::InputEventFilter;
+    using Linux::Input::InputEventFilterImplementation;
+
+    std::vector<input_event> events((options.events + Linux::Input::InputEventBatchSize - 1) / Linux::Input::InputEventBatchSize * Linux::Input::InputEventBatchSize);
+    uint32_t seed = 1;
+    for (auto& event : events) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t kind = (seed >> 16) % 10;
+        if (kind < 4)
+            event = { {}, EV_REL, static_cast<uint16_t>((seed >> 8) % 2 ? REL_X : REL_Y), 1 };
+        else if (kind < 6)
+            event = { {}, EV_SYN, SYN_REPORT, 0 };
+        else if (kind < 9)
+            event = { {}, EV_KEY, static_cast<uint16_t>((seed >> 4) % KEY_CNT), 1 };
+        else
+            event = { {}, EV_MSC, MSC_SCAN, 1 };
+    }
+
+    InputEventFilter severalTypes({ EV_KEY }, { BTN_LEFT, BTN_RIGHT, BTN_MIDDLE });
+    severalTypes.add({ EV_REL }, { REL_X, REL_Y, REL_WHEEL });
+    severalTypes.add({ EV_ABS }, { ABS_X, ABS_Y });
+    const std::vector<std::pair<const char*, InputEventFilter>> filters { { "single key", { { EV_KEY }, { KEY_PLAYPAUSE } } },
+        { "key range", { { EV_KEY }, { KEY_1, KEY_2, KEY_3, KEY_4, KEY_5, KEY_6, KEY_7, KEY_8, KEY_9, KEY_0, KEY_F1, KEY_F2, KEY_F3, KEY_F4 } } },
+        { "letters", { { EV_KEY }, { KEY_A, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H, KEY_I, KEY_J, KEY_K, KEY_L, KEY_M, KEY_N, KEY_O, KEY_P, KEY_Q, KEY_R, KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X, KEY_Y, KEY_Z, KEY_SPACE, KEY_ENTER, KEY_BACKSPACE } } },
+        { "several types", severalTypes }, { "all keys", { { EV_KEY }, { UINT16_MAX } } } };
+
+    std::array<uint32_t, Linux::Input::InputEventBatchSize> indices;
+    for (const auto& filter : filters) {
+        for (auto implementation : { InputEventFilterImplementation::Scalar, InputEventFilterImplementation::Avx2 }) {
+            Linux::Input::InputEventFilterKernel kernel(filter.second, implementation);
+            if (kernel.implementation() != implementation)
+                continue;
+
+            // The batches are selected repeatedly for at least 200 ms
+            size_t selected = 0;
+            size_t passes = 0;
+            auto start = std::chrono::steady_clock::now();
+            std::chrono::duration<double> elapsed {};
+            do {
+                for (size_t offset = 0; offset < events.size(); offset += indices.size())
+                    selected += kernel.select(events.data() + offset, indices.size(), indices.data());
+                ++passes;
+                elapsed = std::chrono::steady_clock::now() - start;
+            } while (elapsed < std::chrono::milliseconds(200));
+
+            std::printf("%-14s %-7s %6.2f ns per event (%.1f%% selected)\n", filter.first, implementation == InputEventFilterImplementation::Scalar ? "scalar" : "avx2", 1e9 * elapsed.count() / (passes * events.size()), 100.0 * selected / (passes * events.size()));
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    BenchmarkOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--devices N] [--events N] [--frame N] [--rate N] [--threads N] [--backend poll|epoll|io_uring] [--batched] [--concurrent] [--uinput] [--filter]" << std::endl;
+        std::cerr << "  --devices N  Number of simulated input devices (default 1)" << std::endl;
+        std::cerr << "  --events N   Number of EV_KEY events written per device (default 100000)" << std::endl;
+        std::cerr << "  --frame N    Number of EV_KEY events per SYN_REPORT frame (default 2)" << std::endl;
+        std::cerr << "  --rate N     EV_KEY events per second per device (default 0 for unlimited)" << std::endl;
+        std::cerr << "  --threads N  Number of reader threads (default 1, more than 1 uses epoll)" << std::endl;
+        std::cerr << "  --backend    The InputEventBackend to use (default poll)" << std::endl;
+        std::cerr << "  --batched    Enable InputEventOptions::batchedRead" << std::endl;
+        std::cerr << "  --concurrent Enable InputEventOptions::concurrentCallbacks" << std::endl;
+        std::cerr << "  --uinput     Use virtual input devices created with uinput instead of FIFOs" << std::endl;
+        std::cerr << "  --filter     Measure the selection of the matching events of batches of N events instead" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (options.filter) {
+        benchmarkFilters(options);
+        return EXIT_SUCCESS;
+    }
+
+    // The input devices are opened through a directory of their own, so no other input devices are read
+    char directory[] = "/tmp/input-event-benchmark-XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::cerr << "Failed to create directory with error " << -errno << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string prefix = std::string(directory) + "/event";
+    std::vector<int> descriptors;
+    std::vector<std::unique_ptr<Linux::Input::InputEventWriter>> virtualDevices;
+
+    if (options.uinput) {
+        // The kernel timestamps the input events written to uinput with the clock selected by the reader
+        options.inputEventOptions.clockId = CLOCK_MONOTONIC;
+
+        for (size_t device = 0; device < options.devices; ++device) {
+            auto writer = std::make_unique<Linux::Input::InputEventWriter>("input-event-benchmark", Linux::Input::InputEventList { EV_KEY }, Linux::Input::InputEventList { UINT16_MAX });
+            std::string path = writer->devicePath();
+            if (writer->descriptor() < 0 || path.empty()) {
+                std::cerr << "Failed to create virtual input device" << std::endl;
+                removeDevices(directory, prefix, descriptors, true);
+                return EXIT_FAILURE;
+            }
+
+            for (int retry = 0; retry < 100 && access(path.c_str(), R_OK); ++retry)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+            // The virtual input devices are linked into the directory instead of probing all of /dev/input
+            if (symlink(path.c_str(), (prefix + std::to_string(device)).c_str()) < 0) {
+                std::cerr << "Failed to link virtual input device with error " << -errno << std::endl;
+                removeDevices(directory, prefix, descriptors, true);
+                return EXIT_FAILURE;
+            }
+
+            descriptors.push_back(writer->descriptor());
+            virtualDevices.push_back(std::move(writer));
+        }
+    } else {
+        // The input devices are simulated with FIFOs which are opened for reading and writing so they never block on open
+        for (size_t device = 0; device < options.devices; ++device) {
+            std::string path = prefix + std::to_string(device);
+            mkfifo(path.c_str(), 0600);
+            descriptors.push_back(open(path.c_str(), O_RDWR));
+        }
+    }
+
+    ReaderMeasurements measurements;
+    const size_t total = options.devices * (options.events / options.frameSize) * options.frameSize;
+    measurements.latencies.reserve(total);
+
+    options.inputEventOptions.collectStats = true;
+    int exitCode = EXIT_SUCCESS;
+    {
+        Linux::Input::InputEvent inputEvent(prefix, std::min<size_t>(options.devices, UINT8_MAX), options.inputEventOptions);
+        int subscription = inputEvent.addSubscription({ EV_KEY }, { UINT16_MAX }, [&measurements](input_event& event) {
+            if (event.type == UINT16_MAX) {
+                std::cerr << "Failed to read input events with error " << event.value << std::endl;
+                return;
+            }
+
+            int64_t latency = monotonicMicroseconds() - (static_cast<int64_t>(event.input_event_sec) * 1000000 + event.input_event_usec);
+            static thread_local pid_t thread = syscall(SYS_gettid);
+
+            // The callbacks of several reader threads may run concurrently with InputEventOptions::concurrentCallbacks
+            std::lock_guard<std::mutex> lock(measurements.mutex);
+            measurements.latencies.push_back(static_cast<uint32_t>(std::max<int64_t>(latency, 0)));
+
+            auto reader = measurements.threads.emplace(thread, ReaderThread {});
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &reader.first->second.lastCpuTime);
+            if (reader.second)
+                reader.first->second.firstCpuTime = reader.first->second.lastCpuTime;
+            measurements.received.fetch_add(1, std::memory_order_release);
+        });
+        if (subscription < 0) {
+            std::cerr << "Failed to subscribe for input events with error " << subscription << std::endl;
+            exitCode = EXIT_FAILURE;
+        } else {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> writers;
+            for (auto descriptor : descriptors)
+                writers.emplace_back(writeEvents, descriptor, std::cref(options));
+
+            while (measurements.received.load(std::memory_order_acquire) < total && std::chrono::steady_clock::now() - start < std::chrono::seconds(60)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                std::lock_guard<std::mutex> lock(measurements.mutex);
+                for (auto& reader : measurements.threads) {
+                    if (reader.second.switches < 0)
+                        reader.second.switches = contextSwitches(reader.first);
+                }
+            }
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            for (auto& writer : writers)
+                writer.join();
+
+            // No callbacks are invoked after the subscription is removed, so the measurements can be read safely
+            inputEvent.removeSubscription(subscription);
+
+            size_t received = measurements.received.load(std::memory_order_acquire);
+            auto stats = inputEvent.stats();
+
+            // The CPU time and the context switches are summed over all reader threads
+            long switches = 0;
+            double cpu = 0;
+            for (auto& reader : measurements.threads) {
+                switches += contextSwitches(reader.first) - std::max(reader.second.switches, 0L);
+                cpu += seconds(reader.second.lastCpuTime) - seconds(reader.second.firstCpuTime);
+            }
+
+            auto latencies = measurements.latencies;
+            std::sort(latencies.begin(), latencies.end());
+            auto percentile = [&latencies](double fraction) { return latencies.empty() ? 0 : latencies[static_cast<size_t>(fraction * (latencies.size() - 1))]; };
+
+            std::printf("backend:            %s\n", inputEvent.backend() == Linux::Input::InputEventBackend::Poll ? "poll" : inputEvent.backend() == Linux::Input::InputEventBackend::Epoll ? "epoll" : "io_uring");
+            std::printf("events received:    %zu of %zu\n", received, total);
+            std::printf("events per second:  %.0f\n", received / elapsed);
+            std::printf("latency p50/p99:    %u/%u us\n", percentile(0.5), percentile(0.99));
+            std::printf("events per batch:   %.2f\n", stats.batches ? static_cast<double>(stats.events) / stats.batches : 0.0);
+            // The voluntary context switches are the times the reader threads blocked waiting for input events
+            std::printf("wakeups per event:  %.3f\n", stats.events ? static_cast<double>(switches) / stats.events : 0.0);
+            std::printf("reader threads:     %zu\n", measurements.threads.size());
+            std::printf("reader cpu usage:   %.1f%%\n", elapsed > 0 ? 100.0 * cpu / elapsed : 0.0);
+            std::printf("SYN_DROPPED events: %llu\n", static_cast<unsigned long long>(stats.dropped));
+
+            if (received < total)
+                exitCode = EXIT_FAILURE;
+        }
+    }
+
+    removeDevices(directory, prefix, descriptors, options.uinput);
+
+    return exitCode;
+}
@@ -4,20 +4,86 @@
 
 #include "InputEvent.h"
 
-#include <cstring>
+#include <atomic>
+#include <chrono>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <thread>
 
+#include <sys/stat.h>
+
 #include "turtle/catch.hpp"
 #include <catch.hpp>
 
 using namespace std::chrono_literals;
 
+/// Helper for creating a FIFO as input event file, as regular files are not supported by epoll and are always readable
+struct InputEventFifo {
+    InputEventFifo(const std::string& inputEventFile)
+        : file(inputEventFile)
+    {
+        remove(file.c_str());
+        REQUIRE(mkfifo(file.c_str(), 0600) == 0);
+        descriptor = open(file.c_str(), O_RDWR | O_NONBLOCK);
+        REQUIRE(descriptor >= 0);
+    }
+
+    ~InputEventFifo()
+    {
+        close(descriptor);
+        remove(file.c_str());
+    }
+
+    /// Writes input events to the FIFO as one write, which is read by the worker thread in one or more batches
+    void write(const input_event* events, size_t count)
+    {
+        CHECK(::write(descriptor, events, count * sizeof(input_event)) == static_cast<ssize_t>(count * sizeof(input_event)));
+    }
+
+    void write(const input_event& event)
+    {
+        write(&event, 1);
+    }
+
+    template <typename Events>
+    void write(const Events& events)
+    {
+        write(events.data(), events.size());
+    }
+
+    std::string file;
+    int descriptor;
+};
+
+/// Helper for waiting until the input events have been delivered asynchronously (or a generous timeout expires)
+/// @return A bool which is true if the condition was met before the timeout
+template <typename Condition>
+bool waitFor(Condition condition, std::chrono::milliseconds timeout = 5s)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(1ms);
+    }
+
+    return true;
+}
+
 TEST_CASE("InputEvent")
 {
     std::string inputEventPrefix = "/tmp/test-input-event";
     std::string inputEventFile = inputEventPrefix + "0";
     std::ofstream inputEventStream(inputEventFile.c_str(), std::ofstream::binary);
+    std::string fifoPrefix = "/tmp/test-input-event-fifo";
+
+    // Appends input events to the regular file, which is always readable
+    auto writeFile = [&inputEventStream](const input_event* events, size_t count = 1) {
+        inputEventStream.write(reinterpret_cast<const char*>(events), count * sizeof(input_event));
+        inputEventStream.flush();
+    };
 
     Linux::Input::InputEvent inputEvent(inputEventPrefix);
 
@@ -44,23 +110,1490 @@ TEST_CASE("InputEvent")
         SECTION("EV_KEY input")
         {
             input_event event { 0, 0, EV_KEY, KEY_COFFEE, 0 };
-            std::array<char, sizeof(input_event)> eventBuffer;
-            std::memcpy(&eventBuffer, &event, sizeof(eventBuffer));
+            std::atomic<int> eventCount { 0 };
 
-            int errorCode = inputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [](input_event& event) {
+            int errorCode = inputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event& event) {
                 CHECK(event.type == EV_KEY);
                 CHECK(event.code == KEY_COFFEE);
+                ++eventCount;
+            });
+            CHECK_FALSE(errorCode);
+
+            writeFile(&event);
+
+            // Wait for the poll to succeed and the callback to be invoked
+            CHECK(waitFor([&] { return eventCount == 1; }));
+        }
+
+        SECTION("Batched EV_KEY input")
+        {
+            std::array<input_event, 3> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_SYN, SYN_REPORT, 0 }, { 0, 0, EV_KEY, KEY_COFFEE, 0 } } };
+            std::atomic<int> eventCount { 0 };
+
+            Linux::Input::InputEventOptions options;
+            options.batchedRead = true;
+            Linux::Input::InputEvent batchedInputEvent(inputEventPrefix, 1, options);
+
+            int errorCode = batchedInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event& event) {
+                CHECK(event.type == EV_KEY);
+                CHECK(event.code == KEY_COFFEE);
+                ++eventCount;
+            });
+            CHECK_FALSE(errorCode);
+
+            writeFile(events.data(), events.size());
+
+            // Wait for the poll to succeed and the callback to be invoked
+            CHECK(waitFor([&] { return eventCount == 2; }));
+        }
+
+        SECTION("Epoll EV_KEY input")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            input_event event { 0, 0, EV_KEY, KEY_COFFEE, 1 };
+            std::atomic<int> eventCount { 0 };
+
+            Linux::Input::InputEventOptions options;
+            options.backend = Linux::Input::InputEventBackend::Epoll;
+
+            {
+                Linux::Input::InputEvent epollInputEvent(inputEventPrefix, 1, options);
+                // Regular files can not be registered with epoll
+                int errorCode = epollInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [](input_event&) {});
+                CHECK(errorCode == -EBADF);
+            }
+
+            Linux::Input::InputEvent epollInputEvent(fifoPrefix, 1, options);
+            int errorCode = epollInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event& event) {
+                CHECK(event.type == EV_KEY);
+                CHECK(event.code == KEY_COFFEE);
+                ++eventCount;
+            });
+            CHECK_FALSE(errorCode);
+
+            fifo.write(event);
+
+            // Wait for the epoll to succeed and the callback to be invoked
+            CHECK(waitFor([&] { return eventCount == 1; }));
+        }
+
+        SECTION("Io_uring EV_KEY input")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 2> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+            std::atomic<int> eventCount { 0 };
+
+            // Non-blocking descriptors make the posted reads wait for readiness first
+            Linux::Input::InputEventOptions options;
+            options.backend = Linux::Input::InputEventBackend::IoUring;
+            options.batchedRead = true;
+            options.hotPlug = true;
+
+            Linux::Input::InputEvent ringInputEvent(fifoPrefix, 2, options);
+            CHECK(ringInputEvent.backend() != Linux::Input::InputEventBackend::Poll);
+            int errorCode = ringInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event& event) {
+                CHECK(event.code == KEY_COFFEE);
+                ++eventCount;
+            });
+            CHECK_FALSE(errorCode);
+
+            fifo.write(events);
+            CHECK(waitFor([&] { return eventCount == 1; }));
+
+            {
+                // The read posted for a removed device is cancelled
+                InputEventFifo addedFifo(fifoPrefix + "1");
+                CHECK(waitFor([&] { return ringInputEvent.devices().size() == 2; }));
+                addedFifo.write(events);
+                CHECK(waitFor([&] { return eventCount == 2; }));
+            }
+            CHECK(waitFor([&] { return ringInputEvent.devices().size() == 1; }));
+
+            fifo.write(events);
+            CHECK(waitFor([&] { return eventCount == 3; }));
+        }
+
+        SECTION("Io_uring read error")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+            std::string directory = fifoPrefix + "1";
+            rmdir(directory.c_str());
+            REQUIRE(mkdir(directory.c_str(), 0700) == 0);
+
+            input_event event { 0, 0, EV_KEY, KEY_COFFEE, 1 };
+            std::atomic<int> eventCount { 0 };
+            std::atomic<int> errorCode { 0 };
+
+            Linux::Input::InputEventOptions options;
+            options.backend = Linux::Input::InputEventBackend::IoUring;
+
+            // A directory can be opened but not read, so the failing read is not posted again
+            Linux::Input::InputEvent ringInputEvent(fifoPrefix, 2, options);
+            if (ringInputEvent.backend() != Linux::Input::InputEventBackend::IoUring) {
+                rmdir(directory.c_str());
+                WARN("io_uring is not available");
+                return;
+            }
+            CHECK(ringInputEvent.devices().size() == 2);
+
+            auto callback = [&](input_event& event) {
+                if (event.type == UINT16_MAX && event.code == UINT16_MAX)
+                    errorCode = event.value;
+                else
+                    ++eventCount;
+            };
+            CHECK(ringInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, callback) == 0);
+            CHECK(waitFor([&] { return errorCode == -EISDIR; }));
+            CHECK(ringInputEvent.devices().size() == 1);
+
+            // The worker thread is stopped and restarted with the remaining devices on the next subscription
+            CHECK(ringInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, callback) == 0);
+            fifo.write(event);
+            CHECK(waitFor([&] { return eventCount == 2; }));
+            rmdir(directory.c_str());
+        }
+
+        SECTION("Immediate stop")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            for (auto backend : { Linux::Input::InputEventBackend::Poll, Linux::Input::InputEventBackend::Epoll }) {
+                Linux::Input::InputEventOptions options;
+                options.backend = backend;
+
+                auto idleInputEvent = std::make_unique<Linux::Input::InputEvent>(fifoPrefix, 1, options);
+                int errorCode = idleInputEvent->subscribe({ EV_KEY }, { KEY_COFFEE }, [](input_event&) {});
+                CHECK_FALSE(errorCode);
+
+                // Let the worker thread block waiting for input events before stopping it
+                std::this_thread::sleep_for(10ms);
+                auto start = std::chrono::steady_clock::now();
+                idleInputEvent.reset();
+                CHECK(std::chrono::steady_clock::now() - start < 100ms);
+            }
+        }
+    }
+
+    SECTION("Test subscriptions")
+    {
+        SECTION("Multiple subscriptions")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 2> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_KEY, KEY_SPACE, 1 } } };
+            std::atomic<int> coffeeCount { 0 };
+            std::atomic<int> spaceCount { 0 };
+            std::atomic<int> onceCount { 0 };
+            int onceSubscription = 0;
+
+            Linux::Input::InputEvent sharedInputEvent(fifoPrefix, 1);
+            int coffeeSubscription = sharedInputEvent.addSubscription({ EV_KEY }, { KEY_COFFEE }, [&coffeeCount](input_event& event) {
+                CHECK(event.code == KEY_COFFEE);
+                ++coffeeCount;
+            });
+            CHECK(coffeeSubscription > 0);
+
+            int spaceSubscription = sharedInputEvent.addSubscription({ EV_KEY }, { KEY_SPACE }, [&spaceCount](input_event& event) {
+                CHECK(event.code == KEY_SPACE);
+                ++spaceCount;
+            });
+            CHECK(spaceSubscription > 0);
+            CHECK(spaceSubscription != coffeeSubscription);
+
+            // A subscription removing itself from within its callback
+            onceSubscription = sharedInputEvent.addSubscription({ EV_KEY }, { UINT16_MAX }, [&](input_event&) {
+                ++onceCount;
+                CHECK(sharedInputEvent.removeSubscription(onceSubscription) == 0);
+            });
+            CHECK(onceSubscription > 0);
+
+            fifo.write(events);
+            CHECK(waitFor([&] { return coffeeCount == 1 && spaceCount == 1; }));
+            CHECK(onceCount == 1);
+
+            CHECK(sharedInputEvent.removeSubscription(coffeeSubscription) == 0);
+            CHECK(sharedInputEvent.removeSubscription(coffeeSubscription) == -ENOENT);
+            CHECK(sharedInputEvent.removeSubscription(onceSubscription) == -ENOENT);
+
+            fifo.write(events);
+            CHECK(waitFor([&] { return spaceCount == 2; }));
+            CHECK(coffeeCount == 1);
+            CHECK(onceCount == 1);
+        }
+
+        SECTION("Template subscription")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 3> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_KEY, KEY_SPACE, 1 }, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+            std::atomic<int> lambdaCount { 0 };
+            std::atomic<int> functionCount { 0 };
+            std::atomic<int> frameCount { 0 };
+
+            Linux::Input::InputEvent templateInputEvent(fifoPrefix, 1);
+            CHECK(templateInputEvent.addSubscription({ EV_KEY }, { KEY_COFFEE }, nullptr) == -EINVAL);
+
+            // A stateful callable stored by value in the subscription
+            CHECK(templateInputEvent.addSubscription({ EV_KEY }, { UINT16_MAX }, [&lambdaCount, count = 0](const input_event&) mutable { lambdaCount = ++count; }) > 0);
+
+            // Modifying the input event does not affect the following subscriptions
+            Linux::Input::InputEventCallback function = [&functionCount](input_event& event) {
+                CHECK(event.code == KEY_SPACE);
+                event.value = 0;
+                ++functionCount;
+            };
+            CHECK(templateInputEvent.subscribe({ EV_KEY }, { KEY_SPACE }, function) == 0);
+            std::atomic<int> spaceValue { -1 };
+            CHECK(templateInputEvent.addSubscription({ EV_KEY }, { KEY_SPACE }, [&spaceValue](const input_event& event) { spaceValue = event.value; }) > 0);
+
+            CHECK(templateInputEvent.addFrameSubscription({ EV_KEY }, { KEY_COFFEE }, [&frameCount](Linux::Input::InputEventSpan frame) {
+                CHECK(frame.size == 2);
+                ++frameCount;
+            }) > 0);
+
+            fifo.write(events);
+            CHECK(waitFor([&] { return frameCount == 1; }));
+            CHECK(lambdaCount == 2);
+            CHECK(functionCount == 1);
+            CHECK(waitFor([&] { return spaceValue == 1; }));
+        }
+
+        SECTION("Device identity")
+        {
+            InputEventFifo fifo0(fifoPrefix + "0");
+            InputEventFifo fifo1(fifoPrefix + "1");
+
+            input_event event { 0, 0, EV_KEY, KEY_COFFEE, 1 };
+            std::atomic<int> eventCount { 0 };
+            std::atomic<int> frameCount { 0 };
+
+            Linux::Input::InputEvent identityInputEvent(fifoPrefix, 2);
+            auto devices = identityInputEvent.devices();
+            REQUIRE(devices.size() == 2);
+            CHECK(devices[0].index != devices[1].index);
+            CHECK(devices[1].path == fifoPrefix + "1");
+
+            CHECK(identityInputEvent.addSubscription({ EV_KEY }, { KEY_COFFEE }, [&](input_event& event, const Linux::Input::InputEventDeviceInfo& device) {
+                CHECK(event.code == KEY_COFFEE);
+                CHECK(device.index == devices[1].index);
+                CHECK(device.path == fifoPrefix + "1");
+                ++eventCount;
+            }) > 0);
+
+            CHECK(identityInputEvent.addFrameSubscription({ EV_KEY }, { KEY_COFFEE }, [&](Linux::Input::InputEventSpan frame, const Linux::Input::InputEventDeviceInfo& device) {
+                CHECK(frame.size == 2);
+                CHECK(device.index == devices[1].index);
+                ++frameCount;
+            }) > 0);
+
+            std::array<input_event, 2> events { { event, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+            fifo1.write(events);
+            CHECK(waitFor([&] { return frameCount == 1; }));
+            CHECK(eventCount == 1);
+        }
+
+        SECTION("Queue subscription")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 2> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_KEY, KEY_COFFEE, 0 } } };
+            Linux::Input::InputEventQueue eventQueue(16);
+
+            Linux::Input::InputEventOptions options;
+            options.batchedRead = true;
+            Linux::Input::InputEvent queueInputEvent(fifoPrefix, 1, options);
+            CHECK(queueInputEvent.addSubscription({ EV_KEY }, { KEY_COFFEE }, eventQueue) > 0);
+
+            fifo.write(events);
+
+            pollfd pollDescriptor { eventQueue.descriptor(), POLLIN, 0 };
+            REQUIRE(poll(&pollDescriptor, 1, 1000) == 1);
+
+            std::vector<int> values;
+            // The events may be delivered in more than one batch
+            while (values.size() < events.size() && poll(&pollDescriptor, 1, 1000) == 1)
+                eventQueue.drain([&values](input_event& event) { values.push_back(event.value); });
+            CHECK(values == std::vector<int> { 1, 0 });
+            CHECK(eventQueue.overflows() == 0);
+        }
+
+        SECTION("Frame subscription")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 8> events { { { 0, 0, EV_ABS, ABS_X, 1 }, { 0, 0, EV_ABS, ABS_Y, 2 }, { 0, 0, EV_SYN, SYN_REPORT, 0 },
+                { 0, 0, EV_ABS, ABS_X, 3 }, { 0, 0, EV_SYN, SYN_DROPPED, 0 }, { 0, 0, EV_ABS, ABS_X, 4 }, { 0, 0, EV_MSC, MSC_SCAN, 5 }, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+            std::mutex frameMutex;
+            std::vector<std::vector<int>> frames;
+            std::vector<std::vector<int>> yFrames;
+
+            Linux::Input::InputEventOptions options;
+            options.batchedRead = true;
+            Linux::Input::InputEvent frameInputEvent(fifoPrefix, 1, options);
+
+            int errorCode = frameInputEvent.addFrameSubscription({ EV_ABS }, { ABS_X, ABS_Y }, [&](Linux::Input::InputEventSpan frame) {
+                std::lock_guard<std::mutex> lock(frameMutex);
+                CHECK(frame[frame.size - 1].code == SYN_REPORT);
+                frames.emplace_back();
+                for (const auto& event : frame)
+                    frames.back().push_back(event.value);
+            });
+            CHECK(errorCode > 0);
+
+            errorCode = frameInputEvent.addFrameSubscription({ EV_ABS }, { ABS_Y }, [&](Linux::Input::InputEventSpan frame) {
+                std::lock_guard<std::mutex> lock(frameMutex);
+                yFrames.emplace_back();
+                for (const auto& event : frame)
+                    yFrames.back().push_back(event.value);
+            });
+            CHECK(errorCode > 0);
+
+            fifo.write(events);
+
+            // Wait for the poll to succeed and the callbacks to be invoked
+            CHECK(waitFor([&] {
+                std::lock_guard<std::mutex> lock(frameMutex);
+                return frames.size() == 2;
+            }));
+            std::lock_guard<std::mutex> lock(frameMutex);
+            CHECK(frames == std::vector<std::vector<int>> { { 1, 2, 0 }, { 4, 0 } });
+            CHECK(yFrames == std::vector<std::vector<int>> { { 2, 0 } });
+        }
+
+        SECTION("Oversized frame")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            // A frame one input event larger than the maximum followed by a regular frame
+            std::vector<input_event> events(Linux::Input::InputEventMaxFrameSize, input_event { 0, 0, EV_ABS, ABS_X, 1 });
+            events.push_back({ 0, 0, EV_SYN, SYN_REPORT, 0 });
+            events.push_back({ 0, 0, EV_ABS, ABS_X, 7 });
+            events.push_back({ 0, 0, EV_SYN, SYN_REPORT, 0 });
+
+            std::mutex frameMutex;
+            std::vector<std::vector<int>> frames;
+
+            Linux::Input::InputEventOptions options;
+            options.batchedRead = true;
+            options.collectStats = true;
+            Linux::Input::InputEvent frameInputEvent(fifoPrefix, 1, options);
+            CHECK(frameInputEvent.addFrameSubscription({ EV_ABS }, { ABS_X }, [&](Linux::Input::InputEventSpan frame) {
+                std::lock_guard<std::mutex> lock(frameMutex);
+                frames.emplace_back();
+                for (const auto& event : frame)
+                    frames.back().push_back(event.value);
+            }) > 0);
+
+            fifo.write(events);
+            CHECK(waitFor([&] {
+                std::lock_guard<std::mutex> lock(frameMutex);
+                return frames.size() == 1;
+            }));
+            std::lock_guard<std::mutex> lock(frameMutex);
+            CHECK(frames == std::vector<std::vector<int>> { { 7, 0 } });
+            CHECK(frameInputEvent.stats().oversizedFrames == 1);
+        }
+
+        SECTION("Batch subscription")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 4> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_KEY, KEY_SPACE, 1 }, { 0, 0, EV_KEY, KEY_COFFEE, 0 }, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+            std::atomic<int> batchCount { 0 };
+            std::atomic<int> staticCount { 0 };
+
+            Linux::Input::InputEventOptions options;
+            options.batchedRead = true;
+
+            Linux::Input::InputEvent batchInputEvent(fifoPrefix, 1, options);
+            CHECK(batchInputEvent.addBatchSubscription({ EV_KEY }, { KEY_COFFEE }, Linux::Input::InputEventBatchCallback()) == -EINVAL);
+            CHECK(batchInputEvent.addBatchSubscription({ EV_KEY }, { KEY_COFFEE }, [&batchCount](const Linux::Input::InputEventBatch& batch) {
+                CHECK(batch.events.size == 4);
+                REQUIRE(batch.size == 2);
+                CHECK(batch.indices[0] == 0);
+                CHECK(batch.indices[1] == 2);
+                CHECK(batch[1].value == 0);
+                ++batchCount;
+            }) > 0);
+
+            CHECK(batchInputEvent.addBatchSubscription(Linux::Input::StaticFilter<EV_KEY, KEY_SPACE>(), [&](const Linux::Input::InputEventBatch& batch, const Linux::Input::InputEventDeviceInfo& device) {
+                CHECK(device.path == fifoPrefix + "0");
+                REQUIRE(batch.size == 1);
+                CHECK(&batch[0] == &batch.events[1]);
+                ++staticCount;
+            }) > 0);
+
+            fifo.write(events);
+            CHECK(waitFor([&] { return batchCount == 1 && staticCount == 1; }));
+        }
+    }
+
+    SECTION("Test devices")
+    {
+        SECTION("Resynchronize after SYN_DROPPED")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 6> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_SYN, SYN_DROPPED, 0 }, { 0, 0, EV_KEY, KEY_COFFEE, 0 },
+                { 0, 0, EV_SYN, SYN_REPORT, 0 }, { 0, 0, EV_KEY, KEY_COFFEE, 2 }, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+            std::mutex eventMutex;
+            std::vector<std::pair<uint16_t, int>> received;
+
+            Linux::Input::InputEventOptions options;
+            options.batchedRead = true;
+            options.resynchronize = true;
+            Linux::Input::InputEvent resyncInputEvent(fifoPrefix, 1, options);
+
+            int errorCode = resyncInputEvent.subscribe({ EV_KEY, EV_SYN }, { UINT16_MAX }, [&](input_event& event) {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                received.emplace_back(event.code, event.value);
+            });
+            CHECK_FALSE(errorCode);
+
+            fifo.write(events);
+
+            // The events between SYN_DROPPED and SYN_REPORT are discarded. As the state of a FIFO can not be queried
+            // no events are synthesized.
+            CHECK(waitFor([&] {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                return received.size() == 4;
+            }));
+            std::lock_guard<std::mutex> lock(eventMutex);
+            CHECK(received == std::vector<std::pair<uint16_t, int>> { { KEY_COFFEE, 1 }, { SYN_DROPPED, 0 }, { KEY_COFFEE, 2 }, { SYN_REPORT, 0 } });
+        }
+
+        SECTION("Hot plug")
+        {
+            std::string hotPlugPrefix = "/tmp/test-input-event-hotplug";
+            remove((hotPlugPrefix + "0").c_str());
+
+            for (auto backend : { Linux::Input::InputEventBackend::Poll, Linux::Input::InputEventBackend::Epoll }) {
+                input_event event { 0, 0, EV_KEY, KEY_COFFEE, 1 };
+                std::atomic<int> eventCount { 0 };
+                Linux::Input::InputEventBits eventBits;
+
+                Linux::Input::InputEventOptions options;
+                options.backend = backend;
+                options.batchedRead = true;
+                options.hotPlug = true;
+                Linux::Input::InputEvent hotPlugInputEvent(hotPlugPrefix, 2, options);
+                CHECK(hotPlugInputEvent.values(EV_KEY, eventBits) == -EBADF);
+
+                // Subscribing is possible before any devices are present
+                int errorCode = hotPlugInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event&) { ++eventCount; });
+                CHECK_FALSE(errorCode);
+
+                {
+                    auto fifo = std::make_unique<InputEventFifo>(hotPlugPrefix + "0");
+                    // Devices outside of the monitored range are ignored
+                    InputEventFifo ignoredFifo(hotPlugPrefix + "2");
+
+                    // Will fail as we are using a FIFO for testing
+                    CHECK(waitFor([&] { return hotPlugInputEvent.values(EV_KEY, eventBits) == -ENOTTY; }));
+                    CHECK(hotPlugInputEvent.devices().size() == 1);
+
+                    ignoredFifo.write(event);
+                    fifo->write(event);
+                    CHECK(waitFor([&] { return eventCount == 1; }));
+
+                    fifo.reset();
+                    CHECK(waitFor([&] { return hotPlugInputEvent.values(EV_KEY, eventBits) == -EBADF; }));
+                }
+            }
+        }
+
+        SECTION("Device lifecycle")
+        {
+            InputEventFifo fifo0(fifoPrefix + "0");
+            InputEventFifo fifo1(fifoPrefix + "1");
+
+            input_event event { 0, 0, EV_KEY, KEY_COFFEE, 1 };
+            std::atomic<int> eventCount { 0 };
+            std::atomic<int> errorCode { 0 };
+
+            Linux::Input::InputEventOptions options;
+            options.nonBlocking = true;
+            options.grab = true;
+
+            // FIFOs can not be grabbed, so they are opened without it
+            Linux::Input::InputEvent lifecycleInputEvent(fifoPrefix, 2, options);
+            CHECK(lifecycleInputEvent.devices().size() == 2);
+            CHECK(lifecycleInputEvent.grabDevice(fifo0.file) == -ENOTTY);
+            CHECK(lifecycleInputEvent.grabDevice(fifoPrefix + "2") == -ENOENT);
+            CHECK(lifecycleInputEvent.closeDevice(fifoPrefix + "2") == -ENOENT);
+
+            // Without the worker thread the requests are handled right away
+            CHECK(lifecycleInputEvent.closeDevice(fifo1.file) == 0);
+            CHECK(lifecycleInputEvent.devices().size() == 1);
+            CHECK(lifecycleInputEvent.reopenDevice(fifoPrefix + "2") == -ENOENT);
+            CHECK(lifecycleInputEvent.reopenDevice(fifo1.file) == 0);
+            CHECK(lifecycleInputEvent.devices().size() == 2);
+
+            CHECK(lifecycleInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&](input_event& event) {
+                if (event.type == UINT16_MAX && event.code == UINT16_MAX)
+                    errorCode = event.value;
+                else
+                    ++eventCount;
+            }) == 0);
+
+            fifo0.write(event);
+            fifo1.write(event);
+            CHECK(waitFor([&] { return eventCount == 2; }));
+
+            // A closed device is no longer read while the other devices are
+            CHECK(lifecycleInputEvent.closeDevice(fifo1.file) == 0);
+            CHECK(waitFor([&] { return lifecycleInputEvent.devices().size() == 1; }));
+            fifo1.write(event);
+            fifo0.write(event);
+            CHECK(waitFor([&] { return eventCount == 3; }));
+
+            // The reopened device reads the events written while it was closed
+            CHECK(lifecycleInputEvent.reopenDevice(fifo1.file) == 0);
+            CHECK(waitFor([&] { return eventCount == 4; }));
+            CHECK(lifecycleInputEvent.devices().size() == 2);
+
+            // Failures of the worker thread are reported as error events
+            CHECK(lifecycleInputEvent.reopenDevice(fifoPrefix + "2") == 0);
+            CHECK(waitFor([&] { return errorCode == -ENOENT; }));
+
+            // Requests made by a callback are handled by the worker thread after the callback returns
+            std::atomic<int> requestResult { 1 };
+            CHECK(lifecycleInputEvent.addSubscription({ EV_KEY }, { KEY_SPACE }, [&](input_event&) {
+                requestResult = lifecycleInputEvent.closeDevice(fifo1.file);
+            }) > 0);
+            fifo1.write(input_event { 0, 0, EV_KEY, KEY_SPACE, 1 });
+            CHECK(waitFor([&] { return lifecycleInputEvent.devices().size() == 1; }));
+            CHECK(requestResult == 0);
+        }
+
+        SECTION("Directory scan")
+        {
+            std::string scanPrefix = "/tmp/test-input-event-scan";
+            InputEventFifo fifo3(scanPrefix + "3");
+            InputEventFifo fifo12(scanPrefix + "12");
+            InputEventFifo fifo1024(scanPrefix + "1024");
+            InputEventFifo ignoredFifo(scanPrefix + "-12");
+            InputEventFifo zeroFifo(scanPrefix + "012");
+
+            input_event event { 0, 0, EV_KEY, KEY_COFFEE, 1 };
+            std::atomic<int> eventCount { 0 };
+            std::vector<Linux::Input::InputEventBits> deviceBits;
+
+            Linux::Input::InputEventOptions options;
+            options.batchedRead = true;
+            options.scanDirectory = true;
+            options.filterDevices = true;
+            Linux::Input::InputEvent scanInputEvent(scanPrefix, 1, options);
+
+            // Will fail as we are using a FIFO for testing
+            CHECK(scanInputEvent.values(EV_KEY, deviceBits) == -ENOTTY);
+
+            // The capabilities of a FIFO are unknown so it is monitored
+            int errorCode = scanInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event&) { ++eventCount; });
+            CHECK_FALSE(errorCode);
+
+            fifo3.write(event);
+            fifo12.write(event);
+            fifo1024.write(event);
+            ignoredFifo.write(event);
+            zeroFifo.write(event);
+            CHECK(waitFor([&] { return eventCount == 3; }));
+            CHECK(scanInputEvent.devices().size() == 3);
+        }
+
+        SECTION("Kernel filter")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 2> events { { { 0, 0, EV_MSC, MSC_SCAN, 1 }, { 0, 0, EV_KEY, KEY_COFFEE, 1 } } };
+            std::atomic<int> eventCount { 0 };
+
+            Linux::Input::InputEventOptions options;
+            options.batchedRead = true;
+            options.kernelFilter = true;
+            Linux::Input::InputEvent maskedInputEvent(fifoPrefix, 1, options);
+
+            // EVIOCSMASK is not supported by a FIFO so the events are filtered when dispatching them instead
+            int errorCode = maskedInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event& event) {
+                CHECK(event.code == KEY_COFFEE);
+                ++eventCount;
+            });
+            CHECK_FALSE(errorCode);
+
+            fifo.write(events);
+            CHECK(waitFor([&] { return eventCount == 1; }));
+        }
+
+        SECTION("Clock selection")
+        {
+            input_event event { 0, 0, EV_KEY, KEY_COFFEE, 1 };
+            event.input_event_sec = 5;
+            event.input_event_usec = 250;
+            std::atomic<int> eventCount { 0 };
+
+            CHECK(Linux::Input::inputEventTime(event).time_since_epoch() == 5s + 250us);
+            CHECK(Linux::Input::inputEventTime<std::chrono::steady_clock>(event).time_since_epoch() == 5s + 250us);
+
+            // Devices without support for the clock keep their default clock
+            Linux::Input::InputEventOptions options;
+            options.clockId = CLOCK_MONOTONIC;
+
+            Linux::Input::InputEvent clockInputEvent(inputEventPrefix, 1, options);
+            CHECK(clockInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event& event) {
+                CHECK(Linux::Input::inputEventTime<std::chrono::steady_clock>(event).time_since_epoch() == 5s + 250us);
+                ++eventCount;
+            }) == 0);
+
+            writeFile(&event);
+            CHECK(waitFor([&] { return eventCount == 1; }));
+        }
+    }
+
+    SECTION("Test threads")
+    {
+        SECTION("Thread options")
+        {
+            input_event event { 0, 0, EV_KEY, KEY_COFFEE, 1 };
+            std::atomic<int> eventCount { 0 };
+            std::atomic<bool> named { false };
+            std::atomic<int> cpu { -1 };
+
+            // Pin the worker thread to the first CPU the test is allowed to run on
+            cpu_set_t cpus;
+            CHECK(sched_getaffinity(0, sizeof(cpus), &cpus) == 0);
+            int firstCpu = 0;
+            while (firstCpu < 63 && !CPU_ISSET(firstCpu, &cpus))
+                ++firstCpu;
+
+            Linux::Input::InputEventOptions options;
+            options.threadName = "input-event";
+            options.threadAffinity = uint64_t { 1 } << firstCpu;
+            options.threadStackPrefault = 64 * 1024;
+
+            Linux::Input::InputEvent threadInputEvent(inputEventPrefix, 1, options);
+            CHECK(threadInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&](input_event&) {
+                char name[16] {};
+                named = !pthread_getname_np(pthread_self(), name, sizeof(name)) && std::string(name) == "input-event";
+                cpu = sched_getcpu();
+                ++eventCount;
+            }) == 0);
+
+            writeFile(&event);
+            CHECK(waitFor([&] { return eventCount == 1; }));
+            CHECK(named);
+            CHECK(cpu == firstCpu);
+        }
+
+        SECTION("Invalid thread options")
+        {
+            // A real-time policy requires a priority of at least 1
+            Linux::Input::InputEventOptions options;
+            options.threadPolicy = SCHED_FIFO;
+
+            Linux::Input::InputEvent threadInputEvent(inputEventPrefix, 1, options);
+            CHECK(threadInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [](input_event&) {}) == -EINVAL);
+            CHECK(threadInputEvent.removeSubscription(1) == -ENOENT);
+
+            // The failure is returned again by the next subscription
+            CHECK(threadInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [](input_event&) {}) == -EINVAL);
+        }
+
+        SECTION("External dispatch")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 2> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+            int eventCount = 0;
+            std::thread::id callbackThread;
+
+            CHECK(inputEvent.descriptor() < 0);
+            CHECK(inputEvent.dispatch() == -EPERM);
+
+            Linux::Input::InputEventOptions options;
+            options.externalDispatch = true;
+
+            Linux::Input::InputEvent externalInputEvent(fifoPrefix, 1, options);
+            CHECK(externalInputEvent.descriptor() >= 0);
+            CHECK(externalInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&](input_event&) {
+                callbackThread = std::this_thread::get_id();
+                ++eventCount;
+            }) == 0);
+            CHECK(externalInputEvent.dispatch() == 0);
+
+            fifo.write(events);
+            pollfd pollDescriptor { externalInputEvent.descriptor(), POLLIN, 0 };
+            CHECK(poll(&pollDescriptor, 1, 1000) == 1);
+
+            int count = 0;
+            while (count < 2 && poll(&pollDescriptor, 1, 100) == 1) {
+                int result = externalInputEvent.dispatch();
+                CHECK(result >= 0);
+                count += result;
+            }
+            CHECK(count == 2);
+            CHECK(eventCount == 1);
+            CHECK(callbackThread == std::this_thread::get_id());
+        }
+
+        SECTION("Reader threads")
+        {
+            std::vector<std::unique_ptr<InputEventFifo>> fifos;
+            for (int index = 0; index < 4; ++index)
+                fifos.push_back(std::make_unique<InputEventFifo>(fifoPrefix + std::to_string(index)));
+
+            input_event event { 0, 0, EV_KEY, KEY_COFFEE, 1 };
+            std::atomic<int> eventCount { 0 };
+            std::atomic<bool> inside { false };
+            std::atomic<bool> overlapped { false };
+            std::mutex threadsMutex;
+            std::set<std::thread::id> threads;
+
+            SECTION("Serialized callbacks")
+            {
+                Linux::Input::InputEventOptions options;
+                options.readerThreads = 3;
+                options.collectStats = true;
+
+                Linux::Input::InputEvent readerInputEvent(fifoPrefix, fifos.size(), options);
+                CHECK(readerInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&](input_event&) {
+                    std::lock_guard<std::mutex> lock(threadsMutex);
+                    threads.insert(std::this_thread::get_id());
+                    ++eventCount;
+                }) == 0);
+
+                for (const auto& fifo : fifos)
+                    fifo->write(event);
+                CHECK(waitFor([&] { return eventCount == 4; }));
+                CHECK(threads.size() > 1);
+                CHECK(readerInputEvent.stats().events == 4);
+            }
+
+            SECTION("Concurrent callbacks")
+            {
+                Linux::Input::InputEventOptions options;
+                options.readerThreads = 4;
+                options.concurrentCallbacks = true;
+
+                // A subscription is never invoked concurrently with itself
+                Linux::Input::InputEvent readerInputEvent(fifoPrefix, fifos.size(), options);
+                CHECK(readerInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&](input_event&) {
+                    if (inside.exchange(true))
+                        overlapped = true;
+                    std::this_thread::sleep_for(10ms);
+                    inside = false;
+                    ++eventCount;
+                }) == 0);
+
+                for (int round = 0; round < 5; ++round) {
+                    for (const auto& fifo : fifos)
+                        fifo->write(event);
+                }
+                CHECK(waitFor([&] { return eventCount == 20; }));
+                CHECK(!overlapped);
+            }
+        }
+    }
+
+    SECTION("Test statistics")
+    {
+        InputEventFifo fifo(fifoPrefix + "0");
+
+        std::array<input_event, 4> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_KEY, KEY_SPACE, 1 }, { 0, 0, EV_SYN, SYN_DROPPED, 0 }, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+        std::atomic<int> eventCount { 0 };
+
+        // Dispatching on the test thread updates the filter counted against before reading the input events
+        Linux::Input::InputEventOptions options;
+        options.batchedRead = true;
+        options.collectStats = true;
+        options.externalDispatch = true;
+
+        Linux::Input::InputEvent statsInputEvent(fifoPrefix, 1, options);
+        CHECK(statsInputEvent.stats().events == 0);
+        CHECK(statsInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event&) { ++eventCount; }) == 0);
+        CHECK(statsInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE, KEY_SPACE }, [&eventCount](input_event&) { ++eventCount; }) == 0);
+
+        fifo.write(events);
+        CHECK(statsInputEvent.dispatch() == 4);
+        CHECK(eventCount == 3);
+
+        auto stats = statsInputEvent.stats();
+        CHECK(stats.events == 4);
+        CHECK(stats.batches == 1);
+        CHECK(stats.filtered == 2);
+        CHECK(stats.deliveries == 3);
+        CHECK(stats.dropped == 1);
+        CHECK(stats.maxCallbackTime <= stats.callbackTime);
+
+        // The timestamps of the written events are far in the past
+        uint64_t latencies = 0;
+        for (auto count : stats.latency)
+            latencies += count;
+        CHECK(latencies == 4);
+        CHECK(stats.latency.back() == 4);
+    }
+
+    SECTION("Test debounce")
+    {
+        SECTION("Debounce and repeat limiting")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            Linux::Input::InputEventOptions options;
+            options.collectStats = true;
+            options.debounce.push_back({ EV_SW, SW_LID, 50ms, 0us });
+            options.debounce.push_back({ EV_KEY, UINT16_MAX, 0us, 100ms });
+
+            std::mutex eventMutex;
+            std::vector<input_event> received;
+            int frameCount = 0;
+
+            Linux::Input::InputEvent debounceInputEvent(fifoPrefix, 1, options);
+            CHECK(debounceInputEvent.addSubscription({ EV_KEY, EV_SW }, { UINT16_MAX }, [&](input_event& event) {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                received.push_back(event);
+            }) > 0);
+            CHECK(debounceInputEvent.addFrameSubscription({ EV_SW }, { UINT16_MAX }, [&](Linux::Input::InputEventSpan) {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                ++frameCount;
+            }) > 0);
+
+            timeval now;
+            gettimeofday(&now, nullptr);
+            auto event = [&now](int64_t offset, uint16_t type, uint16_t code, int32_t value) {
+                int64_t time = now.tv_sec * 1000000LL + now.tv_usec + offset;
+                return input_event { { time / 1000000, time % 1000000 }, type, code, value };
+            };
+
+            // A bouncing switch settling to closed and then to open within the debounce window
+            std::vector<input_event> events;
+            for (int64_t offset : { 0, 5000, 10000, 15000 }) {
+                events.push_back(event(offset, EV_SW, SW_LID, offset % 10000 ? 0 : 1));
+                events.push_back(event(offset, EV_SYN, SYN_REPORT, 0));
+            }
+
+            // A key held for 250 ms with the kernel repeating every 10 ms
+            events.push_back(event(0, EV_KEY, KEY_VOLUMEUP, 1));
+            for (int64_t offset = 10000; offset <= 250000; offset += 10000)
+                events.push_back(event(offset, EV_KEY, KEY_VOLUMEUP, 2));
+            events.push_back(event(250000, EV_KEY, KEY_VOLUMEUP, 0));
+
+            fifo.write(events);
+
+            // The held back release of the switch is delivered before the first input event after the window
+            std::vector<std::pair<uint16_t, int32_t>> expected { { SW_LID, 1 }, { KEY_VOLUMEUP, 1 }, { SW_LID, 0 }, { KEY_VOLUMEUP, 2 }, { KEY_VOLUMEUP, 2 }, { KEY_VOLUMEUP, 0 } };
+            CHECK(waitFor([&] {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                return received.size() == expected.size();
+            }));
+
+            std::lock_guard<std::mutex> lock(eventMutex);
+            std::vector<std::pair<uint16_t, int32_t>> values;
+            for (const auto& entry : received)
+                values.emplace_back(entry.code, entry.value);
+
+            CHECK(values == expected);
+            REQUIRE(received.size() == expected.size());
+            CHECK(received[2].input_event_usec == (now.tv_usec + 50000) % 1000000);
+            CHECK(received[3].input_event_usec == (now.tv_usec + 100000) % 1000000);
+            CHECK(frameCount == 2);
+            CHECK(debounceInputEvent.stats().debounced == 3 + 3 + 23);
+        }
+
+        SECTION("Debounce within a batch")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            Linux::Input::InputEventOptions options;
+            options.batchedRead = true;
+            options.debounce.push_back({ EV_SW, SW_LID, 50ms, 0us });
+            options.debounce.push_back({ EV_KEY, KEY_A, 50ms, 0us });
+
+            std::mutex eventMutex;
+            std::vector<std::pair<uint16_t, int32_t>> values;
+
+            Linux::Input::InputEvent debounceInputEvent(fifoPrefix, 1, options);
+            CHECK(debounceInputEvent.addSubscription({ EV_KEY, EV_SW }, { UINT16_MAX }, [&](const input_event& event) {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                values.emplace_back(event.code, event.value);
+            }) > 0);
+
+            timeval now;
+            gettimeofday(&now, nullptr);
+            auto event = [&now](int64_t offset, uint16_t type, uint16_t code, int32_t value) {
+                int64_t time = now.tv_sec * 1000000LL + now.tv_usec + offset;
+                return input_event { { time / 1000000, time % 1000000 }, type, code, value };
+            };
+
+            // All input events are read at once, so the held back values are released between the input events before
+            // and after their deadlines and the repeat of the held back key press is dropped
+            std::vector<input_event> events { event(0, EV_SW, SW_LID, 1), event(0, EV_KEY, KEY_A, 1), event(0, EV_SYN, SYN_REPORT, 0),
+                event(10000, EV_SW, SW_LID, 0), event(10000, EV_SYN, SYN_REPORT, 0),
+                event(60000, EV_KEY, KEY_A, 0), event(60000, EV_SYN, SYN_REPORT, 0),
+                event(70000, EV_KEY, KEY_A, 1), event(70000, EV_SYN, SYN_REPORT, 0),
+                event(80000, EV_KEY, KEY_A, 2), event(80000, EV_SYN, SYN_REPORT, 0),
+                event(120000, EV_KEY, KEY_A, 2), event(120000, EV_SYN, SYN_REPORT, 0) };
+            fifo.write(events);
+
+            std::vector<std::pair<uint16_t, int32_t>> expected { { SW_LID, 1 }, { KEY_A, 1 }, { SW_LID, 0 }, { KEY_A, 0 }, { KEY_A, 1 }, { KEY_A, 2 } };
+            CHECK(waitFor([&] {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                return values.size() == expected.size();
+            }));
+
+            std::lock_guard<std::mutex> lock(eventMutex);
+            CHECK(values == expected);
+        }
+
+        SECTION("Debounce timer")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            Linux::Input::InputEventOptions options;
+            options.debounce.push_back({ EV_SW, UINT16_MAX, 200ms, 0us });
+
+            std::mutex eventMutex;
+            std::vector<input_event> received;
+            std::vector<std::chrono::system_clock::time_point> deliveries;
+
+            Linux::Input::InputEvent debounceInputEvent(fifoPrefix, 1, options);
+            CHECK(debounceInputEvent.addSubscription({ EV_SW }, { SW_LID }, [&](input_event& event) {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                received.push_back(event);
+                deliveries.push_back(std::chrono::system_clock::now());
+            }) > 0);
+
+            timeval now;
+            gettimeofday(&now, nullptr);
+            std::array<input_event, 2> events { { { now, EV_SW, SW_LID, 1 }, { now, EV_SW, SW_LID, 0 } } };
+            fifo.write(events);
+
+            // Without further input events the held back release is delivered by the timer, never before the window ends
+            CHECK(waitFor([&] {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                return received.size() == 2;
+            }));
+
+            std::lock_guard<std::mutex> lock(eventMutex);
+            CHECK(deliveries[1] >= Linux::Input::inputEventTime(events[1]) + 200ms);
+            CHECK(received[1].value == 0);
+            CHECK(received[1].input_event_usec == (now.tv_usec + 200000) % 1000000);
+        }
+    }
+
+    SECTION("Test gestures")
+    {
+        InputEventFifo fifo(fifoPrefix + "0");
+
+        Linux::Input::InputEventOptions options;
+        options.gestures.push_back({ Linux::Input::InputEventGestureKind::LongPress, EV_KEY, { KEY_A }, 100ms });
+        options.gestures.push_back({ Linux::Input::InputEventGestureKind::DoublePress, EV_KEY, { KEY_B }, 100ms });
+        options.gestures.push_back({ Linux::Input::InputEventGestureKind::Chord, EV_KEY, { KEY_LEFTCTRL, KEY_C }, 50ms });
+
+        std::mutex eventMutex;
+        std::vector<input_event> received;
+
+        Linux::Input::InputEvent gestureInputEvent(fifoPrefix, 1, options);
+        CHECK(gestureInputEvent.addSubscription({ Linux::Input::InputEventGestureType }, { UINT16_MAX }, [&](input_event& event) {
+            std::lock_guard<std::mutex> lock(eventMutex);
+            received.push_back(event);
+        }) > 0);
+
+        // The input events of the gestures are only dispatched to subscriptions listing their type
+        std::atomic<int> wildcardGestures { 0 };
+        CHECK(gestureInputEvent.addSubscription({ UINT16_MAX }, { UINT16_MAX }, [&](const input_event& event) {
+            wildcardGestures += event.type == Linux::Input::InputEventGestureType;
+        }) > 0);
+
+        timeval now;
+        gettimeofday(&now, nullptr);
+        auto event = [&now](int64_t offset, uint16_t code, int32_t value) {
+            int64_t time = now.tv_sec * 1000000LL + now.tv_usec + offset;
+            return input_event { { time / 1000000, time % 1000000 }, EV_KEY, code, value };
+        };
+
+        // A held while B is pressed twice and Ctrl+C is pressed (C too late for a second chord)
+        std::vector<input_event> events { event(0, KEY_A, 1), event(0, KEY_B, 1), event(0, KEY_LEFTCTRL, 1), event(10000, KEY_B, 0),
+            event(20000, KEY_C, 1), event(30000, KEY_C, 0), event(40000, KEY_B, 1), event(60000, KEY_B, 0), event(70000, KEY_C, 1),
+            event(80000, KEY_C, 0), event(80000, KEY_LEFTCTRL, 0) };
+        fifo.write(events);
+
+        // The long press is recognized by the timer as A is never released
+        CHECK(waitFor([&] {
+            std::lock_guard<std::mutex> lock(eventMutex);
+            return received.size() == 3;
+        }));
+        std::lock_guard<std::mutex> lock(eventMutex);
+        REQUIRE(received.size() == 3);
+        CHECK(received[0].code == 2);
+        CHECK(received[0].input_event_usec == (now.tv_usec + 20000) % 1000000);
+        CHECK(received[1].code == 1);
+        CHECK(received[1].input_event_usec == (now.tv_usec + 40000) % 1000000);
+        CHECK(received[2].code == 0);
+        CHECK(received[2].input_event_usec == (now.tv_usec + 100000) % 1000000);
+        CHECK(received[2].value == 1);
+        CHECK(wildcardGestures == 0);
+    }
+
+    SECTION("Test queue")
+    {
+        Linux::Input::InputEventQueue eventQueue(3);
+        CHECK(eventQueue.capacity() == 4);
+        CHECK(eventQueue.descriptor() >= 0);
+
+        input_event event { 0, 0, EV_KEY, KEY_COFFEE, 0 };
+        for (int value = 0; value < 5; ++value) {
+            event.value = value;
+            CHECK(eventQueue.push(event) == (value < 4));
+        }
+        CHECK(eventQueue.overflows() == 1);
+
+        std::array<input_event, 3> events;
+        CHECK(eventQueue.pop(events.data(), events.size()) == 3);
+        CHECK(events[0].value == 0);
+        CHECK(events[2].value == 2);
+
+        // Wrap around the end of the buffer
+        event.value = 4;
+        CHECK(eventQueue.push(event));
+        CHECK(eventQueue.pop(event));
+        CHECK(event.value == 3);
+        CHECK(eventQueue.pop(event));
+        CHECK(event.value == 4);
+        CHECK_FALSE(eventQueue.pop(event));
+    }
+
+    SECTION("Test filter")
+    {
+        SECTION("Specific types and codes")
+        {
+            Linux::Input::InputEventFilter filter({ EV_KEY, EV_SW }, { KEY_COFFEE, SW_LID });
+            CHECK(filter.matches({ 0, 0, EV_KEY, KEY_COFFEE, 1 }));
+            CHECK(filter.matches({ 0, 0, EV_SW, SW_LID, 1 }));
+            CHECK(filter.matches({ 0, 0, EV_SW, KEY_COFFEE, 1 }));
+            CHECK_FALSE(filter.matches({ 0, 0, EV_KEY, KEY_SPACE, 1 }));
+            CHECK_FALSE(filter.matches({ 0, 0, EV_ABS, ABS_X, 1 }));
+            CHECK_FALSE(filter.matches({ 0, 0, UINT16_MAX, UINT16_MAX, 1 }));
+            CHECK(filter.matchesType(EV_KEY));
+            CHECK_FALSE(filter.matchesType(EV_ABS));
+            CHECK(filter.codes(EV_SW).count() == 2);
+            CHECK(filter.codes(EV_SW)[SW_LID]);
+        }
+
+        SECTION("All types and codes")
+        {
+            Linux::Input::InputEventFilter filter({ UINT16_MAX }, { UINT16_MAX });
+            CHECK(filter.matches({ 0, 0, EV_ABS, ABS_X, 1 }));
+            CHECK(filter.matches({ 0, 0, EV_KEY, KEY_MAX, 1 }));
+            CHECK(filter.matchesType(EV_MAX));
+        }
+
+        SECTION("Combining filters")
+        {
+            Linux::Input::InputEventFilter filter;
+            CHECK_FALSE(filter.matches({ 0, 0, EV_KEY, KEY_COFFEE, 1 }));
+
+            filter.add(EV_KEY, KEY_COFFEE);
+            CHECK(filter.matches({ 0, 0, EV_KEY, KEY_COFFEE, 1 }));
+            CHECK_FALSE(filter.matches({ 0, 0, EV_SW, KEY_COFFEE, 1 }));
+
+            Linux::Input::InputEventFilter switchFilter({ EV_SW }, { SW_LID });
+            CHECK_FALSE(filter.intersects(switchFilter));
+
+            switchFilter.merge(filter);
+            CHECK(switchFilter.matches({ 0, 0, EV_KEY, KEY_COFFEE, 1 }));
+            CHECK(switchFilter.matches({ 0, 0, EV_SW, SW_LID, 1 }));
+            CHECK(filter.intersects(switchFilter));
+            CHECK_FALSE(filter.intersects(Linux::Input::InputEventFilter({ EV_KEY }, { KEY_SPACE })));
+
+            filter.add(EV_SW, UINT16_MAX);
+            CHECK(filter.matches({ 0, 0, EV_SW, SW_MAX, 1 }));
+            CHECK_FALSE(filter.matches({ 0, 0, EV_LED, LED_MUTE, 1 }));
+        }
+
+        SECTION("Static filter")
+        {
+            using MediaFilter = Linux::Input::StaticFilter<EV_KEY, KEY_PLAY, KEY_PAUSE, KEY_STOPCD>;
+            static_assert(MediaFilter::matches(EV_KEY, KEY_PLAY), "KEY_PLAY must match");
+            static_assert(!MediaFilter::matches(EV_SW, KEY_PLAY), "EV_SW must not match");
+
+            MediaFilter filter;
+            CHECK(filter.matches({ 0, 0, EV_KEY, KEY_PAUSE, 1 }));
+            CHECK(filter.matches({ 0, 0, EV_KEY, KEY_STOPCD, 1 }));
+            CHECK_FALSE(filter.matches({ 0, 0, EV_KEY, KEY_SPACE, 1 }));
+            CHECK_FALSE(filter.matches({ 0, 0, EV_KEY, KEY_PLAY - 64, 1 }));
+
+            // Codes spread over more than 64 codes and wildcards
+            Linux::Input::StaticFilter<EV_KEY, KEY_ESC, KEY_COFFEE> spreadFilter;
+            CHECK(spreadFilter.matches({ 0, 0, EV_KEY, KEY_ESC, 1 }));
+            CHECK(spreadFilter.matches({ 0, 0, EV_KEY, KEY_COFFEE, 1 }));
+            CHECK_FALSE(spreadFilter.matches({ 0, 0, EV_KEY, KEY_SPACE, 1 }));
+            CHECK(Linux::Input::StaticFilter<UINT16_MAX, UINT16_MAX>().matches({ 0, 0, EV_ABS, ABS_X, 1 }));
+            CHECK_FALSE(Linux::Input::StaticFilter<EV_SW, UINT16_MAX>().matches({ 0, 0, EV_KEY, SW_LID, 1 }));
+
+            // Conversion to the runtime filter
+            Linux::Input::InputEventFilter runtimeFilter(MediaFilter::types(), MediaFilter::codes());
+            CHECK(runtimeFilter.matches({ 0, 0, EV_KEY, KEY_PLAY, 1 }));
+            runtimeFilter.merge(spreadFilter);
+            CHECK(runtimeFilter.matches({ 0, 0, EV_KEY, KEY_ESC, 1 }));
+            CHECK(runtimeFilter.intersects(filter));
+        }
+
+        SECTION("Static filter subscription")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 3> events { { { 0, 0, EV_KEY, KEY_PLAY, 1 }, { 0, 0, EV_KEY, KEY_SPACE, 1 }, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+            std::atomic<int> staticCount { 0 };
+            std::atomic<int> runtimeCount { 0 };
+            Linux::Input::InputEventQueue queue(8);
+
+            Linux::Input::InputEvent filterInputEvent(fifoPrefix, 1);
+            CHECK(filterInputEvent.subscribe(Linux::Input::StaticFilter<EV_KEY, KEY_PLAY, KEY_PAUSE>(), [&staticCount](input_event& event) {
+                CHECK(event.code == KEY_PLAY);
+                ++staticCount;
+            }) == 0);
+            CHECK(filterInputEvent.addSubscription(Linux::Input::InputEventFilter({ EV_KEY }, { KEY_SPACE }), [&runtimeCount](input_event&) { ++runtimeCount; }) > 0);
+            CHECK(filterInputEvent.addSubscription(Linux::Input::StaticFilter<EV_SYN, SYN_REPORT>(), queue) > 0);
+
+            fifo.write(events);
+            CHECK(waitFor([&] { return staticCount == 1 && runtimeCount == 1; }));
+
+            input_event event {};
+            CHECK(queue.pop(event));
+            CHECK(event.code == SYN_REPORT);
+        }
+
+        SECTION("Filter kernel")
+        {
+            std::vector<input_event> events;
+            uint32_t seed = 1;
+            for (size_t index = 0; index < 67; ++index) {
+                seed = seed * 1103515245 + 12345;
+                uint16_t type = (seed >> 8) % (EV_CNT + 2);
+                uint16_t code = (seed >> 16) % 4 ? (seed >> 12) % 8 : (seed >> 4) % (KEY_CNT + 16);
+                events.push_back({ 0, 0, type, code, 1 });
+            }
+
+            // A single code, a range of codes, several types with selected codes, types with all codes and no codes
+            Linux::Input::InputEventFilter severalTypes({ EV_KEY }, { 0, 3 });
+            severalTypes.add({ EV_REL }, { 1, 2, 3 });
+            severalTypes.add({ Linux::Input::InputEventGestureType }, { 4 });
+            std::vector<Linux::Input::InputEventFilter> filters { { { EV_KEY }, { 5 } }, { { EV_KEY }, { 1, 2, 3, 4, 5, 6 } }, severalTypes,
+                { { EV_REL, EV_ABS }, { UINT16_MAX } }, { { UINT16_MAX }, { UINT16_MAX } }, { { EV_KEY }, { 0, 2, 4, 6, 8 } }, {} };
+
+            for (const auto& filter : filters) {
+                std::vector<uint32_t> expected(events.size());
+                std::vector<uint32_t> indices(events.size());
+
+                for (auto implementation : { Linux::Input::InputEventFilterImplementation::Scalar, Linux::Input::InputEventFilterImplementation::Avx2 }) {
+                    Linux::Input::InputEventFilterKernel kernel(filter, implementation);
+                    CHECK((kernel.implementation() == implementation || kernel.implementation() == Linux::Input::InputEventFilterImplementation::Scalar));
+
+                    // All batch sizes to cover the scalar tail of the SIMD implementation
+                    bool equal = true;
+                    for (size_t count = 0; count <= events.size(); ++count) {
+                        size_t size = filter.select(events.data(), count, expected.data());
+                        equal &= kernel.select(events.data(), count, indices.data()) == size && std::equal(expected.begin(), expected.begin() + size, indices.begin());
+                    }
+                    CHECK(equal);
+                }
+            }
+
+            // Filters with more ranges than compared with SIMD instructions use the bitmap lookup
+            CHECK(Linux::Input::InputEventFilterKernel(filters[5]).implementation() == Linux::Input::InputEventFilterImplementation::Scalar);
+            CHECK(Linux::Input::InputEventFilterKernel::supported(Linux::Input::InputEventFilterKernel::bestImplementation()));
+        }
+
+        SECTION("Duplicate codes")
+        {
+            std::atomic<int> eventCount { 0 };
+            input_event event { 0, 0, EV_KEY, KEY_COFFEE, 0 };
+
+            Linux::Input::InputEvent filterInputEvent(inputEventPrefix, 1);
+            int errorCode = filterInputEvent.subscribe({ EV_KEY, EV_KEY }, { KEY_COFFEE, KEY_COFFEE, UINT16_MAX }, [&eventCount](input_event&) {
+                ++eventCount;
             });
             CHECK_FALSE(errorCode);
 
-            inputEventStream.write(eventBuffer.data(), eventBuffer.size());
-            inputEventStream.flush();
+            writeFile(&event);
 
             // Wait for the poll to succeed and the callback to be invoked
-            std::this_thread::sleep_for(100ms);
+            CHECK(waitFor([&] { return eventCount == 1; }));
+        }
+    }
+
+    SECTION("Test writer")
+    {
+        SECTION("Unavailable uinput")
+        {
+            Linux::Input::InputEventWriter writer("test-input-event", { EV_KEY }, { KEY_COFFEE }, "/tmp/test-input-event-uinput");
+            CHECK(writer.descriptor() < 0);
+            CHECK(writer.devicePath().empty());
+            CHECK(writer.write(EV_KEY, KEY_COFFEE, 1) == -EBADF);
+
+            // A regular file does not support the uinput ioctls
+            std::ofstream("/tmp/test-input-event-uinput").close();
+            Linux::Input::InputEventWriter fileWriter("test-input-event", { EV_KEY }, { KEY_COFFEE }, "/tmp/test-input-event-uinput");
+            CHECK(fileWriter.descriptor() < 0);
+            remove("/tmp/test-input-event-uinput");
+        }
+
+        SECTION("Virtual input device")
+        {
+            Linux::Input::InputEventWriter writer("test-input-event", { EV_KEY }, { KEY_COFFEE, KEY_SPACE });
+            if (writer.descriptor() < 0) {
+                WARN("uinput is not available");
+                return;
+            }
+
+            // Wait for the device node to be created
+            std::string path = writer.devicePath();
+            REQUIRE_FALSE(path.empty());
+            CHECK(waitFor([&] { return access(path.c_str(), R_OK) == 0; }));
+
+            std::atomic<int> eventCount { 0 };
+            auto separator = path.find_last_not_of("0123456789") + 1;
+            int number = std::stoi(path.substr(separator));
+
+            // Opens all devices up to the virtual input device, which exercises the real ioctl paths
+            Linux::Input::InputEvent writerInputEvent(path.substr(0, separator), number + 1);
+            CHECK(writerInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event&) { ++eventCount; }) == 0);
+
+            CHECK(writer.write(EV_KEY, KEY_COFFEE, 1) == 0);
+            CHECK(waitFor([&] { return eventCount == 1; }));
+            CHECK(writerInputEvent.value(EV_KEY, KEY_COFFEE) == 1);
+            CHECK(writerInputEvent.value(EV_KEY, KEY_SPACE) == 0);
+
+            CHECK(writer.write(EV_KEY, KEY_COFFEE, 0) == 0);
+            CHECK(waitFor([&] { return eventCount == 2; }));
+            CHECK(writerInputEvent.value(EV_KEY, KEY_COFFEE) == 0);
+
+            // A grabbed device can not be grabbed by another instance
+            Linux::Input::InputEvent grabInputEvent(path.substr(0, separator), number + 1);
+            CHECK(writerInputEvent.grabDevice(path) == 0);
+            CHECK(grabInputEvent.grabDevice(path) == -EBUSY);
+            CHECK(writerInputEvent.grabDevice(path, false) == 0);
+            CHECK(grabInputEvent.grabDevice(path) == 0);
+        }
+
+        SECTION("Removed virtual input device")
+        {
+            auto writer = std::make_unique<Linux::Input::InputEventWriter>("test-input-event", Linux::Input::InputEventList { EV_KEY }, Linux::Input::InputEventList { KEY_COFFEE });
+            if (writer->descriptor() < 0) {
+                WARN("uinput is not available");
+                return;
+            }
+
+            std::string path = writer->devicePath();
+            REQUIRE_FALSE(path.empty());
+            CHECK(waitFor([&] { return access(path.c_str(), R_OK) == 0; }));
+            auto separator = path.find_last_not_of("0123456789") + 1;
+            int number = std::stoi(path.substr(separator));
+
+            Linux::Input::InputEventOptions options;
+            options.backend = Linux::Input::InputEventBackend::IoUring;
+
+            // A removed device is closed without hot plugging as it can not be read anymore
+            Linux::Input::InputEvent removedInputEvent(path.substr(0, separator), number + 1, options);
+            CHECK(removedInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [](input_event&) {}) == 0);
+            auto devices = removedInputEvent.devices().size();
+            writer.reset();
+            CHECK(waitFor([&] { return removedInputEvent.devices().size() == devices - 1; }));
+        }
+
+        SECTION("Filtered virtual input device")
+        {
+            Linux::Input::InputEventWriter writer("test-input-event", { EV_KEY }, { KEY_COFFEE });
+            if (writer.descriptor() < 0) {
+                WARN("uinput is not available");
+                return;
+            }
+
+            std::string path = writer.devicePath();
+            REQUIRE_FALSE(path.empty());
+            CHECK(waitFor([&] { return access(path.c_str(), R_OK) == 0; }));
+            auto separator = path.find_last_not_of("0123456789") + 1;
+            int number = std::stoi(path.substr(separator));
+
+            Linux::Input::InputEventOptions options;
+            options.filterDevices = true;
+            Linux::Input::InputEvent filteredInputEvent(path.substr(0, separator), number + 1, options);
+            CHECK(filteredInputEvent.subscribe({ EV_REL }, { REL_X }, [](input_event&) {}) == 0);
+
+            // More input events than the kernel queues for the device while no subscription matches it
+            for (int press = 0; press < 1000; ++press) {
+                CHECK(writer.write(EV_KEY, KEY_COFFEE, 1) == 0);
+                CHECK(writer.write(EV_KEY, KEY_COFFEE, 0) == 0);
+            }
+
+            auto subscribed = std::chrono::system_clock::now();
+            std::vector<input_event> received;
+            std::mutex receivedMutex;
+            CHECK(filteredInputEvent.addSubscription({ EV_KEY, EV_SYN }, { KEY_COFFEE, SYN_DROPPED }, [&](input_event& event, const Linux::Input::InputEventDeviceInfo& device) {
+                std::lock_guard<std::mutex> lock(receivedMutex);
+                if (device.path == path)
+                    received.push_back(event);
+            }) > 0);
+
+            // Only the input events written after the subscription are received (without stale ones or SYN_DROPPED)
+            CHECK(waitFor([&] {
+                CHECK(writer.write(EV_KEY, KEY_COFFEE, 1) == 0);
+                CHECK(writer.write(EV_KEY, KEY_COFFEE, 0) == 0);
+                std::lock_guard<std::mutex> lock(receivedMutex);
+                return !received.empty() && received.back().value == 0;
+            }));
+
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            for (const auto& event : received) {
+                CHECK(event.type == EV_KEY);
+                CHECK(Linux::Input::inputEventTime(event) >= subscribed);
+            }
         }
     }
 
+    SECTION("Test recording")
+    {
+        std::string recording = "/tmp/test-input-event-recording";
+
+        SECTION("Record and replay")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 3> events { { { { 100, 500 }, EV_KEY, KEY_COFFEE, 1 }, { { 100, 700 }, EV_ABS, ABS_X, -1000 }, { { 100, 700 }, EV_SYN, SYN_REPORT, 0 } } };
+            std::vector<input_event> received;
+            std::mutex receivedMutex;
+
+            {
+                Linux::Input::InputEventRecorder recorder(recording, 64);
+                REQUIRE(recorder.descriptor() >= 0);
+
+                Linux::Input::InputEvent recordInputEvent(fifoPrefix, 1);
+                CHECK(recordInputEvent.setRecorder(&recorder) == 0);
+                // Input events are recorded before filtering
+                std::atomic<int> eventCount { 0 };
+                CHECK(recordInputEvent.subscribe({ EV_KEY }, { KEY_COFFEE }, [&eventCount](input_event&) { ++eventCount; }) == 0);
+
+                for (int frame = 0; frame < 100; ++frame) {
+                    events[0].value = frame & 1;
+                    fifo.write(events);
+                }
+                CHECK(waitFor([&] { return eventCount == 100; }));
+                CHECK(recordInputEvent.setRecorder(nullptr) == 0);
+
+                // The recording is much smaller than the raw input events and grown beyond its initial capacity
+                CHECK(recorder.size() > 64);
+                CHECK(recorder.size() < 100 * sizeof(events) / 2);
+            }
+
+            Linux::Input::InputEventReplayer replayer(recording);
+            REQUIRE(replayer.descriptor() >= 0);
+
+            Linux::Input::InputEventOptions options;
+            options.externalDispatch = true;
+            Linux::Input::InputEvent replayInputEvent(fifoPrefix, 1, options);
+            CHECK(replayInputEvent.subscribe({ EV_KEY, EV_ABS }, { KEY_COFFEE, ABS_X }, [&](input_event& event) {
+                std::lock_guard<std::mutex> lock(receivedMutex);
+                received.push_back(event);
+            }) == 0);
+
+            CHECK(replayInputEvent.replay(replayer, 0) == 300);
+            REQUIRE(received.size() == 200);
+            CHECK(received[1].type == EV_ABS);
+            CHECK(received[1].value == -1000);
+            CHECK(received[2].value == 1);
+            CHECK(received[0].input_event_sec == 100);
+            CHECK(received[0].input_event_usec == 500);
+            CHECK(received[1].input_event_usec == 700);
+            REQUIRE(replayer.devices().size() == 1);
+            // A FIFO has no name
+            CHECK(replayer.devices()[0].name.empty());
+
+            // Replaying at the original speed takes the recorded time (no time passes between the frames)
+            replayer.rewind();
+            received.clear();
+            auto start = std::chrono::steady_clock::now();
+            CHECK(replayInputEvent.replay(replayer) == 300);
+            CHECK(std::chrono::steady_clock::now() - start < 100ms);
+            CHECK(received.size() == 200);
+            CHECK(replayInputEvent.replay(replayer) == 0);
+        }
+
+        SECTION("Replayed long press")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            // The recording ends while the key is still pressed
+            std::array<input_event, 2> events { { { { 100, 0 }, EV_KEY, KEY_A, 1 }, { { 100, 0 }, EV_SYN, SYN_REPORT, 0 } } };
+            {
+                Linux::Input::InputEventRecorder recorder(recording);
+                Linux::Input::InputEvent recordInputEvent(fifoPrefix, 1);
+                CHECK(recordInputEvent.setRecorder(&recorder) == 0);
+                std::atomic<int> eventCount { 0 };
+                CHECK(recordInputEvent.subscribe({ EV_KEY }, { KEY_A }, [&eventCount](input_event&) { ++eventCount; }) == 0);
+
+                fifo.write(events);
+                CHECK(waitFor([&] { return eventCount == 1; }));
+                CHECK(recordInputEvent.setRecorder(nullptr) == 0);
+            }
+
+            Linux::Input::InputEventReplayer replayer(recording);
+            REQUIRE(replayer.descriptor() >= 0);
+
+            Linux::Input::InputEventOptions options;
+            options.externalDispatch = true;
+            options.gestures.push_back({ Linux::Input::InputEventGestureKind::LongPress, EV_KEY, { KEY_A }, 100ms });
+            Linux::Input::InputEvent replayInputEvent(fifoPrefix, 1, options);
+            int gestureCount = 0;
+            CHECK(replayInputEvent.addSubscription({ Linux::Input::InputEventGestureType }, { UINT16_MAX }, [&gestureCount](const input_event&) { ++gestureCount; }) > 0);
+
+            // The long press is not recognized as its time has not passed within the recording
+            CHECK(replayInputEvent.replay(replayer, 0) == 2);
+            CHECK(gestureCount == 0);
+        }
+
+        SECTION("Unfinished recording")
+        {
+            std::array<input_event, 2> events { { { { 100, 0 }, EV_KEY, KEY_A, 1 }, { { 100, 0 }, EV_SYN, SYN_REPORT, 0 } } };
+
+            // The file keeps the zero filled capacity of the mapping until the recorder is destroyed (e.g. on a crash)
+            Linux::Input::InputEventRecorder recorder(recording);
+            REQUIRE(recorder.addDevice({}) == 0);
+            CHECK(recorder.record(0, events.data(), events.size()) == 0);
+
+            Linux::Input::InputEventReplayer replayer(recording);
+            REQUIRE(replayer.descriptor() >= 0);
+
+            size_t device = 1;
+            input_event event {};
+            CHECK(replayer.next(device, event));
+            CHECK(device == 0);
+            CHECK(event.code == KEY_A);
+            CHECK(replayer.next(device, event));
+            CHECK(event.code == SYN_REPORT);
+            CHECK_FALSE(replayer.next(device, event));
+        }
+
+        SECTION("Invalid recording")
+        {
+            Linux::Input::InputEventRecorder recorder("/tmp/nonexistent-directory/recording");
+            CHECK(recorder.descriptor() < 0);
+            CHECK(recorder.addDevice({}) == -EBADF);
+            CHECK(inputEvent.setRecorder(&recorder) == -EBADF);
+
+            std::ofstream(recording) << "invalid";
+            Linux::Input::InputEventReplayer replayer(recording);
+            CHECK(replayer.descriptor() < 0);
+            CHECK(inputEvent.replay(replayer) == -EBADF);
+
+            Linux::Input::InputEventReplayer missingReplayer("/tmp/nonexistent-directory/recording");
+            CHECK(missingReplayer.descriptor() < 0);
+        }
+
+        remove(recording.c_str());
+    }
+
     SECTION("Test value")
     {
         SECTION("Invalid input")
@@ -82,6 +1615,64 @@ TEST_CASE("InputEvent")
             // Will fail as we are using a regular file for testing
             CHECK(value == -ENOTTY);
         }
+
+        SECTION("Bulk input")
+        {
+            Linux::Input::InputEventBits eventBits;
+            // Will fail as we are using a regular file for testing
+            CHECK(inputEvent.values(EV_KEY, eventBits) == -ENOTTY);
+            CHECK(inputEvent.values(EV_ABS, eventBits) == -ENOTSUP);
+
+            std::vector<Linux::Input::InputEventBits> deviceBits;
+            CHECK(inputEvent.values(EV_SW, deviceBits) == -ENOTTY);
+        }
+
+        SECTION("Cached state")
+        {
+            InputEventFifo fifo(fifoPrefix + "0");
+
+            std::array<input_event, 4> events { { { 0, 0, EV_KEY, KEY_COFFEE, 1 }, { 0, 0, EV_SW, SW_LID, 1 }, { 0, 0, EV_LED, LED_MUTE, 1 }, { 0, 0, EV_SYN, SYN_REPORT, 0 } } };
+
+            Linux::Input::InputEventOptions options;
+            options.cacheState = true;
+            Linux::Input::InputEvent cachedInputEvent(fifoPrefix, 1, options);
+
+            // The state of a FIFO can not be queried so the cached state starts out cleared
+            CHECK(cachedInputEvent.value(EV_KEY, KEY_COFFEE) == 0);
+            CHECK(cachedInputEvent.value(EV_ABS, ABS_RUDDER) == -ENOTSUP);
+            CHECK(cachedInputEvent.value(EV_REL, REL_X) == -ENOTSUP);
+            CHECK(cachedInputEvent.value(EV_SW, SW_MAX + 1) == -EINVAL);
+
+            // The cache is maintained without any subscriptions
+            fifo.write(events);
+            CHECK(waitFor([&] { return cachedInputEvent.value(EV_LED, LED_MUTE) == 1; }));
+            CHECK(cachedInputEvent.value(EV_KEY, KEY_COFFEE) == 1);
+            CHECK(cachedInputEvent.value(EV_SW, SW_LID) == 1);
+            CHECK(cachedInputEvent.value(EV_LED, LED_MUTE) == 1);
+            CHECK(cachedInputEvent.value(EV_KEY, KEY_SPACE) == 0);
+
+            Linux::Input::InputEventBits eventBits;
+            CHECK(cachedInputEvent.values(EV_KEY, eventBits) == 0);
+            CHECK(eventBits.count() == 1);
+            CHECK(eventBits[KEY_COFFEE]);
+
+            std::vector<Linux::Input::InputEventBits> deviceBits;
+            CHECK(cachedInputEvent.values(EV_SW, deviceBits) == 0);
+            REQUIRE(deviceBits.size() == 1);
+            CHECK(deviceBits[0].count() == 1);
+            CHECK(deviceBits[0][SW_LID]);
+
+            events[0].value = 0;
+            fifo.write(events[0]);
+            CHECK(waitFor([&] { return cachedInputEvent.value(EV_KEY, KEY_COFFEE) == 0; }));
+            CHECK(cachedInputEvent.value(EV_SW, SW_LID) == 1);
+
+            // The cached state of a closed device is no longer read
+            CHECK(cachedInputEvent.closeDevice(fifoPrefix + "0") == 0);
+            CHECK(waitFor([&] { return cachedInputEvent.value(EV_SW, SW_LID) == -EBADF; }));
+            CHECK(cachedInputEvent.reopenDevice(fifoPrefix + "0") == 0);
+            CHECK(waitFor([&] { return cachedInputEvent.value(EV_SW, SW_LID) == 0; }));
+        }
     }
 
     inputEventStream.close();